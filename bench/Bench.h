@@ -0,0 +1,108 @@
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+// Keeps value alive as far as the optimiser is concerned.
+template<typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+inline void clobberMemory() {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : : "memory");
+#endif
+}
+
+// Minimal micro-benchmark harness.
+//
+// Every benchmark gets `warmup` untimed repetitions followed by `reps` timed
+// ones. A repetition calls setup() (untimed) and then body(state), which must
+// perform `ops` operations. One CSV row per benchmark is written to stdout:
+//
+//   bench,params,ops,reps,ns_per_op_mean,ns_per_op_min,ns_per_op_p50,ns_per_op_max
+//
+// Command line: --reps N, --warmup N, --filter SUBSTRING (matched against
+// "bench/params").
+class BenchRunner {
+public:
+    BenchRunner(int argc, char** argv) {
+        for (int i = 1; i < argc; ++i) {
+            const string arg = argv[i];
+            if (arg == "--reps" && i + 1 < argc) {
+                reps_ = max(1, atoi(argv[++i]));
+            } else if (arg == "--warmup" && i + 1 < argc) {
+                warmup_ = max(0, atoi(argv[++i]));
+            } else if (arg == "--filter" && i + 1 < argc) {
+                filter_ = argv[++i];
+            }
+        }
+        cout << "bench,params,ops,reps,"
+                "ns_per_op_mean,ns_per_op_min,ns_per_op_p50,ns_per_op_max\n";
+    }
+
+    [[nodiscard]] bool enabled(const string& name, const string& params) const {
+        return filter_.empty() || (name + "/" + params).find(filter_) != string::npos;
+    }
+
+    template<typename Setup, typename Body>
+    void run(const string& name, const string& params, size_t ops, Setup&& setup, Body&& body) {
+        if (!enabled(name, params) || ops == 0) return;
+
+        for (int w = 0; w < warmup_; ++w) {
+            auto state = setup();
+            body(state);
+            clobberMemory();
+        }
+
+        vector<double> ns_per_op;
+        ns_per_op.reserve(reps_);
+        for (int r = 0; r < reps_; ++r) {
+            auto state = setup();
+            clobberMemory();
+            const auto start = chrono::steady_clock::now();
+            body(state);
+            clobberMemory();
+            const auto end = chrono::steady_clock::now();
+            ns_per_op.push_back(chrono::duration<double, nano>(end - start).count()
+                                / static_cast<double>(ops));
+        }
+
+        sort(ns_per_op.begin(), ns_per_op.end());
+        const double mean = accumulate(ns_per_op.begin(), ns_per_op.end(), 0.0) / ns_per_op.size();
+        cout << name << "," << params << "," << ops << "," << reps_ << ","
+             << fixed << setprecision(3)
+             << mean << "," << ns_per_op.front() << ","
+             << ns_per_op[ns_per_op.size() / 2] << "," << ns_per_op.back() << endl;
+    }
+
+    // Stateless variant: body() performs `ops` operations.
+    template<typename Body>
+    void run(const string& name, const string& params, size_t ops, Body&& body) {
+        run(name, params, ops, [] { return 0; }, [&](int&) { body(); });
+    }
+
+private:
+    int reps_{10};
+    int warmup_{2};
+    string filter_;
+};
+
+#endif //BENCH_H
@@ -0,0 +1,85 @@
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Bench.h"
+#include "../heap/IndexMinHeap.h"
+#include "../heap/CandidateStore.h"
+#include "../gen/ZipfGenerator.h"
+
+using namespace std;
+
+// IndexMinHeap::update on resident keys and replace_top with fresh keys, over
+// a range of capacities. CandidateStore::offer replays the candidate traffic
+// of CMSSOHH (Zipf keys, running counts as estimates) against both layouts to
+// locate the capacity where the flat store stops paying off.
+
+static constexpr size_t OPS = 1u << 20;
+
+int main(int argc, char** argv) {
+    BenchRunner bench(argc, argv);
+
+    const vector<size_t> capacities = {256, 1024, 4096, 16384};
+
+    for (size_t cap : capacities) {
+        const string params = "capacity=" + to_string(cap);
+
+        auto filled = [cap] {
+            auto heap = make_unique<IndexMinHeap<int, double>>(cap);
+            for (size_t i = 0; i < cap; ++i) heap->insert(static_cast<int>(i), static_cast<double>(i));
+            return heap;
+        };
+
+        // Resident keys drawn uniformly, each bumped by one. The values are
+        // rewound in the untimed setup.
+        vector<int> keys(OPS);
+        mt19937 rng(42);
+        uniform_int_distribution<int> pick(0, static_cast<int>(cap) - 1);
+        for (int& k : keys) k = pick(rng);
+        vector<double> value(cap);
+
+        bench.run("IndexMinHeap::update", params, OPS,
+            [&] {
+                for (size_t i = 0; i < cap; ++i) value[i] = static_cast<double>(i);
+                return filled();
+            },
+            [&](unique_ptr<IndexMinHeap<int, double>>& heap) {
+                for (int k : keys) heap->update(k, value[k] += 1.0);
+                doNotOptimize(heap->min_value());
+            });
+
+        bench.run("IndexMinHeap::replace_top", params, OPS, filled,
+            [&](unique_ptr<IndexMinHeap<int, double>>& heap) {
+                double v = static_cast<double>(cap);
+                int key = static_cast<int>(cap);
+                for (size_t i = 0; i < OPS; ++i) heap->replace_top(key++, v += 1.0);
+                doNotOptimize(heap->min_value());
+            });
+    }
+
+    // Zipf(1.1) over 2^20 keys; the estimate offered is the key's running
+    // count, which is monotone like a Count-Min estimate.
+    const vector<int> stream = ZipfGenerator(0, (1 << 20) - 1, 1.1).generate(OPS);
+    vector<double> estimate(OPS);
+    {
+        unordered_map<int, double> count;
+        for (size_t i = 0; i < OPS; ++i) estimate[i] = count[stream[i]] += 1.0;
+    }
+
+    const vector<size_t> offer_capacities = {64, 256, 512, 1024, 2048, 4096, 8192, 16384};
+    for (size_t cap : offer_capacities) {
+        for (CandidatePolicy policy : {CandidatePolicy::Heap, CandidatePolicy::Flat}) {
+            const string params = "capacity=" + to_string(cap)
+                + " policy=" + (policy == CandidatePolicy::Flat ? "flat" : "heap");
+            bench.run("CandidateStore::offer", params, OPS,
+                [cap, policy] { return make_unique<CandidateStore>(cap, policy, true); },
+                [&](unique_ptr<CandidateStore>& store) {
+                    for (size_t i = 0; i < OPS; ++i) store->offer(stream[i], estimate[i]);
+                    doNotOptimize(store->size());
+                });
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "../gen/ZipfGenerator.h"
+#include "../harness/FusedIngest.h"
+#include "../heavy/CMSSOHH.h"
+#include "../heavy/CSSOHH.h"
+#include "../heavy/MGSO.h"
+#include "../heavy/SSSO.h"
+
+using namespace std;
+
+// The four engines of runHHAlgorithmsAgg (MGSO, SSSO, CMSSOHH, CSSOHH) fed
+// one stream: four separate passes against one FusedIngest pass, with the
+// Count-Min and Count sketches on distinct seeds and on a shared seed, over
+// block sizes.
+
+static constexpr size_t STREAM_ITEMS = 1u << 20;
+static constexpr int K = 128;
+static constexpr int TILDE_K = 256;
+static constexpr int DEPTH = 32;
+static constexpr double EPS = 0.1;
+static constexpr double DELTA = 0.001;
+
+struct Engines {
+    unique_ptr<MGSO> mg;
+    unique_ptr<SSSO> ss;
+    unique_ptr<CMSSOHH> cm;
+    unique_ptr<CSSOHH> cs;
+};
+
+static Engines makeEngines(uint32_t cm_seed, uint32_t cs_index_seed, uint32_t cs_sign_seed) {
+    Engines e;
+    e.mg = make_unique<MGSO>(K, TILDE_K, EPS, DELTA);
+    e.ss = make_unique<SSSO>(K, TILDE_K, EPS, DELTA);
+    e.cm = make_unique<CMSSOHH>(DEPTH, EPS, DELTA, K, 2 * TILDE_K, cm_seed, STREAM_ITEMS);
+    e.cs = make_unique<CSSOHH>(DEPTH, EPS, DELTA, K, 2 * TILDE_K, cs_index_seed, cs_sign_seed, STREAM_ITEMS);
+    return e;
+}
+
+int main(int argc, char** argv) {
+    BenchRunner bench(argc, argv);
+
+    const vector<int> stream = ZipfGenerator(0, 100000, 1.1).generate(STREAM_ITEMS);
+    const string params = "k=" + to_string(K) + " tilde_k=" + to_string(TILDE_K) + " depth=" + to_string(DEPTH);
+
+    bench.run("ingest/separate", params, stream.size(),
+        [&] { return makeEngines(1, 2, 3); },
+        [&](Engines& e) {
+            for (int item : stream) e.mg->update(item);
+            for (int item : stream) e.ss->update(item);
+            for (int item : stream) e.cm->update(item);
+            for (int item : stream) e.cs->update(item);
+        });
+
+    for (size_t block : {64, 256, 1024}) {
+        for (bool shared : {false, true}) {
+            const string name = shared ? "ingest/fused-shared-seed" : "ingest/fused";
+            bench.run(name, params + " block=" + to_string(block), stream.size(),
+                [&] { return makeEngines(1, shared ? 1 : 2, 3); },
+                [&](Engines& e) {
+                    FusedIngest fused(block);
+                    fused.add(*e.mg);
+                    fused.add(*e.ss);
+                    fused.add(*e.cm);
+                    fused.add(*e.cs);
+                    fused.ingest(stream);
+                });
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "../gen/ZipfGenerator.h"
+#include "../heavy/CMSSOHH.h"
+#include "../heavy/CSSOHH.h"
+#include "../heavy/MGSO.h"
+#include "../heavy/SSSO.h"
+
+using namespace std;
+
+// query() of every heavy-hitter engine after ingesting a Zipf stream, over a
+// range of k (tilde_k = 2k as in the experiment sweeps), and point lookups of
+// stream keys through estimate() one at a time and estimate_batch().
+
+static constexpr size_t STREAM_ITEMS = 1u << 20;
+static constexpr size_t QUERIES = 16;
+static constexpr size_t LOOKUPS = 4096;
+static constexpr double EPS = 0.1;
+static constexpr double DELTA = 0.001;
+static constexpr int DEPTH = 32;
+
+int main(int argc, char** argv) {
+    BenchRunner bench(argc, argv);
+
+    const vector<int>    ks    = {64, 256, 1024};
+    const vector<double> skews = {1.1, 2.0};
+
+    for (double skew : skews) {
+        const vector<int> stream = ZipfGenerator(0, 100000, skew).generate(STREAM_ITEMS);
+
+        for (int k : ks) {
+            const size_t tilde_k = 2 * static_cast<size_t>(k);
+            const string params = "k=" + to_string(k)
+                                + " skew=" + to_string(skew).substr(0, 3);
+
+            vector<pair<string, unique_ptr<SketchHH>>> engines;
+            engines.emplace_back("MGSO", make_unique<MGSO>(k, tilde_k, EPS, DELTA));
+            engines.emplace_back("SSSO", make_unique<SSSO>(k, tilde_k, EPS, DELTA));
+            engines.emplace_back("CMSSOHH", make_unique<CMSSOHH>(
+                DEPTH, EPS, DELTA, k, 2 * tilde_k, 42, stream.size()));
+            engines.emplace_back("CSSOHH", make_unique<CSSOHH>(
+                DEPTH, EPS, DELTA, k, 2 * tilde_k, 42, 7, stream.size()));
+
+            // Every 256th stream item: mostly heavy keys, some tail.
+            vector<int> lookups;
+            for (size_t i = 0; i < LOOKUPS; ++i) lookups.push_back(stream[i * 256 % stream.size()]);
+            vector<double> estimates(LOOKUPS);
+
+            for (auto& [name, engine] : engines) {
+                const bool query = bench.enabled(name + "::query", params);
+                const bool point = bench.enabled(name + "::estimate", params);
+                const bool batch = bench.enabled(name + "::estimate_batch", params);
+                if (!query && !point && !batch) continue;
+                for (int item : stream) engine->update(item);
+                engine->query();  // the release MGSO and SSSO look keys up in
+
+                if (query) {
+                    bench.run(name + "::query", params, QUERIES, [&] {
+                        size_t reported = 0;
+                        for (size_t q = 0; q < QUERIES; ++q) reported += engine->query().size();
+                        doNotOptimize(reported);
+                    });
+                }
+                if (point) {
+                    bench.run(name + "::estimate", params, LOOKUPS, [&] {
+                        double sum = 0.0;
+                        for (int item : lookups) sum += engine->estimate(item);
+                        doNotOptimize(sum);
+                    });
+                }
+                if (batch) {
+                    bench.run(name + "::estimate_batch", params, LOOKUPS, [&] {
+                        engine->estimate_batch(lookups, estimates);
+                        doNotOptimize(estimates[0]);
+                    });
+                }
+            }
+        }
+    }
+    return 0;
+}
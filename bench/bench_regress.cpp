@@ -0,0 +1,316 @@
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "../gen/ZipfGenerator.h"
+#include "../harness/LatencyHistogram.h"
+#include "../heavy/CMSSOHH.h"
+#include "../heavy/CSSOHH.h"
+#include "../heavy/MGSO.h"
+#include "../heavy/SSSO.h"
+
+using namespace std;
+
+// Performance regression check for the heavy-hitter engines.
+//
+// Every engine configuration is run `--reps` times on a fixed Zipf stream;
+// each repeat records ns/update, sampled p50/p99 update latency and memory.
+// Repeats go round-robin over the configurations, so slow drift of the
+// machine hits all of them alike, and one untimed round (`--warmup`) comes
+// first.
+//
+//   bench_regress --record bench/baselines/regress.csv   write a new baseline
+//   bench_regress --baseline bench/baselines/regress.csv compare against it
+//
+// Every round also times a fixed calibration loop that uses no engine code
+// (row "calibration"). Timing metrics of a run are scaled by the ratio of
+// its calibration median to the baseline's, so a machine that is slower as a
+// whole, e.g. from frequency scaling or a busy neighbour, does not read as a
+// regression.
+//
+// --record measures `--runs` separate runs (default 3). A metric regresses
+// when the 95% bootstrap confidence interval of median(current) /
+// median(baseline) lies entirely above 1 + tolerance. The tolerance of each
+// configuration and metric is the larger of --tolerance (default 0.05) and
+// the spread of the baseline's per-run medians (max / min - 1), so noise
+// that already separates runs of the same binary does not count. The process
+// exits with status 1 if any metric of any configuration regresses.
+
+static constexpr size_t STREAM_ITEMS = 1u << 20;
+static constexpr double EPS = 0.1;
+static constexpr double DELTA = 0.001;
+static constexpr int DEPTH = 32;
+static constexpr int BOOTSTRAP_RESAMPLES = 2000;
+static constexpr int LATENCY_SAMPLE_SHIFT = 6;
+
+static const vector<string> METRICS = {"ns_per_update", "p50_ns", "p99_ns", "memory_bytes"};
+static const vector<string> TIMING_METRICS = {"ns_per_update", "p50_ns", "p99_ns"};
+static const string CALIBRATION = "calibration";
+static constexpr size_t CALIBRATION_CELLS = size_t{1} << 20;
+
+// config -> metric -> per-repeat samples
+using Samples = map<string, map<string, vector<double>>>;
+
+struct Interval {
+    double lo;
+    double mid;
+    double hi;
+};
+
+double median(vector<double> v) {
+    if (v.empty()) return 0.0;
+    const size_t mid = v.size() / 2;
+    nth_element(v.begin(), v.begin() + mid, v.end());
+    if (v.size() % 2) return v[mid];
+    return 0.5 * (v[mid] + *max_element(v.begin(), v.begin() + mid));
+}
+
+Interval bootstrapRatio(const vector<double>& current, const vector<double>& baseline, mt19937_64& rng) {
+    auto resampleMedian = [&](const vector<double>& v) {
+        uniform_int_distribution<size_t> pick(0, v.size() - 1);
+        vector<double> draw(v.size());
+        for (double& x : draw) x = v[pick(rng)];
+        return median(std::move(draw));
+    };
+
+    vector<double> ratios(BOOTSTRAP_RESAMPLES);
+    for (double& r : ratios) {
+        const double b = resampleMedian(baseline);
+        r = b > 0.0 ? resampleMedian(current) / b : 1.0;
+    }
+    sort(ratios.begin(), ratios.end());
+    const double b = median(baseline);
+    return {ratios[static_cast<size_t>(0.025 * (ratios.size() - 1))],
+            b > 0.0 ? median(current) / b : 1.0,
+            ratios[static_cast<size_t>(0.975 * (ratios.size() - 1))]};
+}
+
+// Relative spread of the per-run medians of one metric, max / min - 1.
+double runSpread(const vector<vector<double>>& runs) {
+    double lo = 0.0, hi = 0.0;
+    bool first = true;
+    for (const auto& run : runs) {
+        if (run.empty()) continue;
+        const double m = median(run);
+        lo = first ? m : min(lo, m);
+        hi = first ? m : max(hi, m);
+        first = false;
+    }
+    return lo > 0.0 ? hi / lo - 1.0 : 0.0;
+}
+
+// ns per item of a splitmix-and-count loop over the stream into a table the
+// size of a large sketch: hashing plus scattered memory traffic, like the
+// engines, but no engine code.
+double calibrationNs(const vector<int>& stream, vector<uint32_t>& table) {
+    const auto start = chrono::steady_clock::now();
+    for (int item : stream) {
+        uint64_t z = static_cast<uint32_t>(item) * 0x9e3779b97f4a7c15ull;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        ++table[(z ^ (z >> 31)) & (table.size() - 1)];
+    }
+    const auto end = chrono::steady_clock::now();
+    doNotOptimize(table.data());
+    clobberMemory();
+    return chrono::duration<double, nano>(end - start).count() / static_cast<double>(stream.size());
+}
+
+// Scales the timing metrics of run by reference / (its calibration median).
+void normalise(Samples& run, double reference) {
+    auto c = run.find(CALIBRATION);
+    if (c == run.end()) return;
+    const double own = median(c->second["ns_per_update"]);
+    if (own <= 0.0) return;
+    for (auto& [config, metrics] : run) {
+        if (config == CALIBRATION) continue;
+        for (const string& metric : TIMING_METRICS) {
+            for (double& v : metrics[metric]) v *= reference / own;
+        }
+    }
+}
+
+// One Samples per recorded run.
+vector<Samples> loadRuns(const string& path) {
+    vector<Samples> runs;
+    ifstream in(path);
+    string line;
+    getline(in, line); // header
+    while (getline(in, line)) {
+        stringstream ss(line);
+        string config, run, repeat;
+        getline(ss, config, ',');
+        getline(ss, run, ',');
+        getline(ss, repeat, ',');
+        const auto r = static_cast<size_t>(strtoul(run.c_str(), nullptr, 10));
+        if (runs.size() <= r) runs.resize(r + 1);
+        for (const string& metric : METRICS) {
+            string field;
+            if (!getline(ss, field, ',')) break;
+            runs[r][config][metric].push_back(strtod(field.c_str(), nullptr));
+        }
+    }
+    return runs;
+}
+
+int main(int argc, char** argv) {
+    int reps = 10;
+    int warmup = 1;
+    int runs = 3;
+    double tolerance = 0.05;
+    string record_path, baseline_path;
+    for (int i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+        if (arg == "--reps" && i + 1 < argc) reps = max(2, atoi(argv[++i]));
+        else if (arg == "--warmup" && i + 1 < argc) warmup = max(0, atoi(argv[++i]));
+        else if (arg == "--runs" && i + 1 < argc) runs = max(1, atoi(argv[++i]));
+        else if (arg == "--tolerance" && i + 1 < argc) tolerance = strtod(argv[++i], nullptr);
+        else if (arg == "--record" && i + 1 < argc) record_path = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc) baseline_path = argv[++i];
+    }
+    if (record_path.empty()) runs = 1;
+
+    const vector<int> stream = ZipfGenerator(0, 100000, 1.1).generate(STREAM_ITEMS);
+
+    vector<pair<string, function<unique_ptr<SketchHH>()>>> configs;
+    for (int k : {128, 1024}) {
+        const size_t tilde_k = 2 * static_cast<size_t>(k);
+        const string suffix = " k=" + to_string(k);
+        configs.emplace_back("MGSO" + suffix, [=] { return make_unique<MGSO>(k, tilde_k, EPS, DELTA); });
+        configs.emplace_back("SSSO" + suffix, [=] { return make_unique<SSSO>(k, tilde_k, EPS, DELTA); });
+        configs.emplace_back("CMSSOHH" + suffix, [=, n = stream.size()] {
+            return make_unique<CMSSOHH>(DEPTH, EPS, DELTA, k, 2 * tilde_k, 42, n); });
+        configs.emplace_back("CSSOHH" + suffix, [=, n = stream.size()] {
+            return make_unique<CSSOHH>(DEPTH, EPS, DELTA, k, 2 * tilde_k, 42, 7, n); });
+    }
+
+    auto measure = [&](const function<unique_ptr<SketchHH>()>& make, map<string, vector<double>>* m) {
+        auto engine = make();
+        LatencyHistogram latency;
+        const size_t block = size_t{1} << LATENCY_SAMPLE_SHIFT;
+
+        const auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < stream.size(); i += block) {
+            const uint64_t t0 = LatencyHistogram::now();
+            engine->update(stream[i]);
+            latency.record(LatencyHistogram::now() - t0);
+            const size_t end = min(stream.size(), i + block);
+            for (size_t j = i + 1; j < end; ++j) engine->update(stream[j]);
+        }
+        const auto end = chrono::steady_clock::now();
+
+        if (!m) return;
+        (*m)["ns_per_update"].push_back(chrono::duration<double, nano>(end - start).count()
+                                        / static_cast<double>(stream.size()));
+        (*m)["p50_ns"].push_back(latency.percentileNs(0.5));
+        (*m)["p99_ns"].push_back(latency.percentileNs(0.99));
+        (*m)["memory_bytes"].push_back(static_cast<double>(engine->memory_bytes()));
+    };
+
+    vector<uint32_t> calibration_table(CALIBRATION_CELLS);
+    vector<Samples> current(runs);
+    for (Samples& samples : current) {
+        for (int w = 0; w < warmup; ++w) {
+            calibrationNs(stream, calibration_table);
+            for (const auto& [config, make] : configs) measure(make, nullptr);
+        }
+        for (int r = 0; r < reps; ++r) {
+            auto& c = samples[CALIBRATION];
+            c["ns_per_update"].push_back(calibrationNs(stream, calibration_table));
+            for (const string& metric : METRICS) {
+                if (metric != "ns_per_update") c[metric].push_back(0.0);
+            }
+            for (const auto& [config, make] : configs) measure(make, &samples[config]);
+        }
+    }
+
+    if (!record_path.empty()) {
+        ofstream out(record_path);
+        if (!out) {
+            cerr << "[ERROR] Could not open baseline file: " << record_path << endl;
+            return 2;
+        }
+        out << "config,run,repeat";
+        for (const string& metric : METRICS) out << "," << metric;
+        out << "\n" << fixed << setprecision(3);
+        for (size_t run = 0; run < current.size(); ++run) {
+            for (const auto& [config, metrics] : current[run]) {
+                for (int r = 0; r < reps; ++r) {
+                    out << config << "," << run << "," << r;
+                    for (const string& metric : METRICS) out << "," << metrics.at(metric)[r];
+                    out << "\n";
+                }
+            }
+        }
+        cout << "[DONE] Baseline written to: " << record_path << endl;
+    }
+
+    if (baseline_path.empty()) return 0;
+
+    vector<Samples> baseline = loadRuns(baseline_path);
+    if (baseline.empty()) {
+        cerr << "[ERROR] Could not read baseline file: " << baseline_path << endl;
+        return 2;
+    }
+
+    vector<double> base_calibration;
+    for (Samples& run : baseline) {
+        const auto& c = run[CALIBRATION]["ns_per_update"];
+        base_calibration.insert(base_calibration.end(), c.begin(), c.end());
+    }
+    const double reference = median(base_calibration);
+    if (reference > 0.0) {
+        for (Samples& run : baseline) normalise(run, reference);
+        normalise(current.front(), reference);
+        cerr << "[INFO] calibration: baseline " << fixed << setprecision(3) << reference
+             << " ns, current " << median(current.front()[CALIBRATION]["ns_per_update"])
+             << " ns; timings scaled to the baseline machine speed\n";
+    }
+
+    mt19937_64 rng(42);
+    bool regressed = false;
+    cout << "config,metric,baseline_median,current_median,ratio,ratio_ci_lo,ratio_ci_hi,tolerance,status\n";
+    for (const auto& [config, metrics] : current.front()) {
+        if (config == CALIBRATION) continue;
+        const bool known = any_of(baseline.begin(), baseline.end(),
+                                  [&](const Samples& run) { return run.count(config) != 0; });
+        if (!known) {
+            cout << config << ",*,,,,,,,missing_baseline\n";
+            continue;
+        }
+        for (const string& metric : METRICS) {
+            vector<double> base;
+            vector<vector<double>> base_runs;
+            for (const Samples& run : baseline) {
+                auto b = run.find(config);
+                if (b == run.end()) continue;
+                auto bm = b->second.find(metric);
+                if (bm == b->second.end() || bm->second.empty()) continue;
+                base.insert(base.end(), bm->second.begin(), bm->second.end());
+                base_runs.push_back(bm->second);
+            }
+            if (base.empty()) continue;
+            const vector<double>& cur = metrics.at(metric);
+
+            const double tol = max(tolerance, runSpread(base_runs));
+            const Interval ci = bootstrapRatio(cur, base, rng);
+            const bool slower = ci.lo > 1.0 + tol;
+            const bool faster = ci.hi < 1.0 - tol;
+            regressed |= slower;
+
+            cout << config << "," << metric << "," << fixed << setprecision(3)
+                 << median(base) << "," << median(cur) << ","
+                 << ci.mid << "," << ci.lo << "," << ci.hi << "," << tol << ","
+                 << (slower ? "REGRESSION" : faster ? "improved" : "ok") << "\n";
+        }
+    }
+    return regressed ? 1 : 0;
+}
@@ -0,0 +1,105 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "../gen/ZipfGenerator.h"
+#include "../sketch/CMSSO.h"
+#include "../sketch/CSSO.h"
+
+using namespace std;
+
+// Sketch::hash and the CMSSO/CSSO update_estimate paths over a grid of
+// widths, depths and stream skews, for the table of doubles and the compact
+// 16-bit counter layout, and the cost of an interval rollover: building a
+// new CMSSO against reset() of the one in hand.
+
+static constexpr size_t STREAM_ITEMS = 1u << 20;
+static constexpr double EPS = 0.1;
+static constexpr size_t ROLLOVERS = 16;
+
+int main(int argc, char** argv) {
+    BenchRunner bench(argc, argv);
+
+    const vector<int>    widths = {256, 1024, 4096, 16384};
+    const vector<int>    depths = {4, 16, 32};
+    const vector<double> skews  = {1.1, 1.5, 2.0};
+
+    {
+        const vector<int> stream = ZipfGenerator(0, 100000, 1.1).generate(STREAM_ITEMS);
+        bench.run("Sketch::hash", "items=" + to_string(stream.size()), stream.size(), [&] {
+            uint32_t acc = 0;
+            for (int item : stream) acc += Sketch::hash(item, 42);
+            doNotOptimize(acc);
+        });
+    }
+
+    for (double skew : skews) {
+        const vector<int> stream = ZipfGenerator(0, 100000, skew).generate(STREAM_ITEMS);
+
+        for (int width : widths) {
+            for (int depth : depths) {
+                const string params = "width=" + to_string(width)
+                                    + " depth=" + to_string(depth)
+                                    + " skew=" + to_string(skew).substr(0, 3);
+
+                bench.run("CMSSO::update_estimate", params, stream.size(),
+                    [&] { return make_unique<CMSSO>(width, depth, EPS, 42); },
+                    [&](unique_ptr<CMSSO>& sketch) {
+                        double acc = 0.0;
+                        for (int item : stream) acc += sketch->update_estimate(item, 1);
+                        doNotOptimize(acc);
+                    });
+
+                bench.run("CSSO::update_estimate", params, stream.size(),
+                    [&] { return make_unique<CSSO>(width, depth, EPS, 42, 7); },
+                    [&](unique_ptr<CSSO>& sketch) {
+                        double acc = 0.0;
+                        for (int item : stream) acc += sketch->update_estimate(item, 1);
+                        doNotOptimize(acc);
+                    });
+
+                bench.run("CMSSO::update_estimate/c16", params, stream.size(),
+                    [&] { return make_unique<CMSSO>(width, depth, EPS, 42, 16); },
+                    [&](unique_ptr<CMSSO>& sketch) {
+                        double acc = 0.0;
+                        for (int item : stream) acc += sketch->update_estimate(item, 1);
+                        doNotOptimize(acc);
+                    });
+
+                bench.run("CSSO::update_estimate/c16", params, stream.size(),
+                    [&] { return make_unique<CSSO>(width, depth, EPS, 42, 7, 16); },
+                    [&](unique_ptr<CSSO>& sketch) {
+                        double acc = 0.0;
+                        for (int item : stream) acc += sketch->update_estimate(item, 1);
+                        doNotOptimize(acc);
+                    });
+            }
+        }
+    }
+    for (int width : widths) {
+        const int depth = 32;
+        const string params = "width=" + to_string(width) + " depth=" + to_string(depth);
+
+        for (int bits : {0, 16}) {
+            const string layout = bits ? "/c16" : "";
+
+            bench.run("CMSSO::rebuild" + layout, params, ROLLOVERS, [&] {
+                for (size_t r = 0; r < ROLLOVERS; ++r) {
+                    auto sketch = make_unique<CMSSO>(width, depth, EPS, 42 + r, bits);
+                    doNotOptimize(sketch->query(0));
+                }
+            });
+
+            bench.run("CMSSO::reset" + layout, params, ROLLOVERS,
+                [&] { return make_unique<CMSSO>(width, depth, EPS, 42, bits); },
+                [&](unique_ptr<CMSSO>& sketch) {
+                    for (size_t r = 0; r < ROLLOVERS; ++r) {
+                        sketch->reset(42 + r);
+                        doNotOptimize(sketch->query(0));
+                    }
+                });
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "../gen/ZipfGenerator.h"
+#include "../heavy/SpaceSaving.h"
+#include "../heavy/MisraGries.h"
+#include "../heavy/SSSO.h"
+#include "../heavy/TenantPool.h"
+
+using namespace std;
+
+// SpaceSaving::update and MisraGries::update over counter capacities and
+// stream skews, the lifetime (build, short stream, teardown) of many
+// short-lived summaries, and many small per-tenant engines: one SSSO per
+// tenant against a TenantPool fed item by item and in batches.
+
+static constexpr size_t STREAM_ITEMS = 1u << 20;
+static constexpr size_t TENANT_BATCH = 1u << 16;
+static constexpr size_t SHORT_ITEMS  = 1u << 12;
+
+int main(int argc, char** argv) {
+    BenchRunner bench(argc, argv);
+
+    const vector<size_t> capacities = {64, 256, 1024, 4096};
+    const vector<double> skews      = {1.1, 1.5, 2.0};
+
+    for (double skew : skews) {
+        const vector<int> stream = ZipfGenerator(0, 100000, skew).generate(STREAM_ITEMS);
+
+        for (size_t cap : capacities) {
+            const string params = "capacity=" + to_string(cap)
+                                + " skew=" + to_string(skew).substr(0, 3);
+
+            bench.run("SpaceSaving::update", params, stream.size(),
+                [&] { return make_unique<SpaceSaving>(cap); },
+                [&](unique_ptr<SpaceSaving>& ss) {
+                    for (int item : stream) ss->update(item);
+                });
+
+            bench.run("MisraGries::update", params, stream.size(),
+                [&] { return make_unique<MisraGries>(cap); },
+                [&](unique_ptr<MisraGries>& mg) {
+                    for (int item : stream) mg->update(item);
+                });
+        }
+    }
+
+    {
+        const vector<int> stream = ZipfGenerator(0, 100000, 1.1).generate(STREAM_ITEMS);
+        for (size_t cap : capacities) {
+            const string params = "capacity=" + to_string(cap) + " items=" + to_string(SHORT_ITEMS);
+
+            bench.run("SpaceSaving::lifetime", params, stream.size(), [&] {
+                for (size_t at = 0; at < stream.size(); at += SHORT_ITEMS) {
+                    SpaceSaving ss(cap);
+                    for (size_t i = at; i < at + SHORT_ITEMS; ++i) ss.update(stream[i]);
+                }
+            });
+
+            bench.run("MisraGries::lifetime", params, stream.size(), [&] {
+                for (size_t at = 0; at < stream.size(); at += SHORT_ITEMS) {
+                    MisraGries mg(cap);
+                    for (size_t i = at; i < at + SHORT_ITEMS; ++i) mg.update(stream[i]);
+                }
+            });
+        }
+    }
+
+    // Tenants drawn Zipf(1.1) over 16384 ids, items Zipf(1.1) per tenant.
+    {
+        const size_t tenants = 16384;
+        const size_t tilde_k = 32;
+        const vector<int> tenant_of = ZipfGenerator(0, static_cast<int>(tenants) - 1, 1.1).generate(STREAM_ITEMS);
+        const vector<int> items = ZipfGenerator(0, 100000, 1.1).generate(STREAM_ITEMS);
+        vector<pair<uint32_t, int>> updates(STREAM_ITEMS);
+        for (size_t i = 0; i < STREAM_ITEMS; ++i) updates[i] = {static_cast<uint32_t>(tenant_of[i]), items[i]};
+        const string params = "tenants=" + to_string(tenants) + " tilde_k=" + to_string(tilde_k);
+
+        bench.run("SSSO::update/per-tenant", params, updates.size(),
+            [&] { return vector<unique_ptr<SSSO>>(tenants); },
+            [&](vector<unique_ptr<SSSO>>& engines) {
+                for (const auto& [tenant, item] : updates) {
+                    auto& e = engines[tenant];
+                    if (!e) e = make_unique<SSSO>(tilde_k / 2, tilde_k, 1.0, 1e-3);
+                    e->update(item);
+                }
+            });
+
+        bench.run("TenantPool::update", params, updates.size(),
+            [&] { return make_unique<TenantPool>(tilde_k / 2, tilde_k, 1.0, 1e-3); },
+            [&](unique_ptr<TenantPool>& pool) {
+                for (const auto& [tenant, item] : updates) pool->update(tenant, item);
+            });
+
+        bench.run("TenantPool::update_batch", params + " batch=" + to_string(TENANT_BATCH), updates.size(),
+            [&] { return make_unique<TenantPool>(tilde_k / 2, tilde_k, 1.0, 1e-3); },
+            [&](unique_ptr<TenantPool>& pool) {
+                vector<pair<uint32_t, int>> batch;
+                for (size_t at = 0; at < updates.size(); at += TENANT_BATCH) {
+                    batch.assign(updates.begin() + at, updates.begin() + min(updates.size(), at + TENANT_BATCH));
+                    pool->update_batch(batch);
+                }
+            });
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+
+#ifndef ZIPFGENERATOR_H
+#define ZIPFGENERATOR_H
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <algorithm>
+
+using namespace std;
+
+struct ZipfOptions {
+    uint64_t seed{42};
+    unsigned threads{0};        // 0 = hardware_concurrency
+    bool permute_keys{false};   // map ranks to keys through a seeded permutation
+    size_t drift_period{0};     // items between hot-key shifts, 0 = no drift
+    size_t drift_shift{1};      // ranks the hot set moves by at each shift
+};
+
+// Zipf(skew) sampler over [min_val, max_val] using Vose's alias method, so a
+// draw costs one 64-bit random number and one table probe.
+//
+// generate() splits the output into fixed-size blocks, each with its own seed
+// derived from (seed, block index), so the stream is identical for any number
+// of threads.
+class ZipfGenerator {
+public:
+    static constexpr size_t BLOCK_ITEMS = 1u << 16;
+
+    ZipfGenerator(int min_val, int max_val, double skew)
+        : min_val_(min_val), n_(static_cast<size_t>(max_val - min_val + 1)) {
+        vector<double> probabilities(n_);
+        double sum = 0.0;
+        for (size_t i = 0; i < n_; ++i) {
+            probabilities[i] = 1.0 / pow(static_cast<double>(i + 1), skew);
+            sum += probabilities[i];
+        }
+        build_alias(probabilities, sum);
+    }
+
+    [[nodiscard]] size_t domain() const { return n_; }
+
+    // Draws a rank in [0, domain()); rank 0 is the most frequent.
+    template<typename Rng>
+    size_t sample_rank(Rng& rng) const {
+        const uint64_t r = rng();
+        const size_t bucket = static_cast<size_t>(((r >> 32) * static_cast<uint64_t>(n_)) >> 32);
+        const double u = static_cast<double>(r & 0xffffffffu) * (1.0 / 4294967296.0);
+        return u < prob_[bucket] ? bucket : alias_[bucket];
+    }
+
+    vector<int> generate(size_t length, const ZipfOptions& opts = {}) const {
+        vector<int> out(length);
+        generate(out.data(), length, opts);
+        return out;
+    }
+
+    void generate(int* out, size_t length, const ZipfOptions& opts = {}) const {
+        vector<int> perm;
+        if (opts.permute_keys) {
+            perm.resize(n_);
+            for (size_t i = 0; i < n_; ++i) perm[i] = min_val_ + static_cast<int>(i);
+            mt19937_64 prng(mix(opts.seed, ~0ull));
+            shuffle(perm.begin(), perm.end(), prng);
+        }
+
+        const size_t blocks = (length + BLOCK_ITEMS - 1) / BLOCK_ITEMS;
+        unsigned threads = opts.threads ? opts.threads : thread::hardware_concurrency();
+        if (threads == 0) threads = 1;
+        threads = static_cast<unsigned>(min<size_t>(threads, max<size_t>(blocks, 1)));
+
+        atomic<size_t> next_block{0};
+        auto worker = [&]() {
+            for (size_t b = next_block++; b < blocks; b = next_block++) {
+                mt19937_64 rng(mix(opts.seed, b));
+                const size_t begin = b * BLOCK_ITEMS;
+                const size_t end = min(length, begin + BLOCK_ITEMS);
+                for (size_t i = begin; i < end; ++i) {
+                    size_t rank = sample_rank(rng);
+                    if (opts.drift_period) {
+                        rank = (rank + (i / opts.drift_period) * opts.drift_shift) % n_;
+                    }
+                    out[i] = perm.empty() ? min_val_ + static_cast<int>(rank) : perm[rank];
+                }
+            }
+        };
+
+        vector<thread> pool;
+        for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+        worker();
+        for (auto& th : pool) th.join();
+    }
+
+private:
+    int min_val_;
+    size_t n_;
+    vector<double> prob_;
+    vector<uint32_t> alias_;
+
+    static uint64_t mix(uint64_t seed, uint64_t stream) {
+        // splitmix64 finaliser over (seed, stream)
+        uint64_t z = seed + 0x9e3779b97f4a7c15ull * (stream + 1);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    void build_alias(const vector<double>& weights, double sum) {
+        prob_.assign(n_, 0.0);
+        alias_.assign(n_, 0);
+
+        vector<double> scaled(n_);
+        vector<uint32_t> small, large;
+        small.reserve(n_);
+        large.reserve(n_);
+        for (size_t i = 0; i < n_; ++i) {
+            scaled[i] = weights[i] * static_cast<double>(n_) / sum;
+            (scaled[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+        }
+
+        while (!small.empty() && !large.empty()) {
+            const uint32_t s = small.back();
+            small.pop_back();
+            const uint32_t l = large.back();
+            prob_[s] = scaled[s];
+            alias_[s] = l;
+            scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+            if (scaled[l] < 1.0) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        for (uint32_t i : large) prob_[i] = 1.0;
+        for (uint32_t i : small) prob_[i] = 1.0;
+    }
+};
+
+#endif //ZIPFGENERATOR_H
@@ -0,0 +1,200 @@
+
+#ifndef EXPERIMENTSCHEDULER_H
+#define EXPERIMENTSCHEDULER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <fstream>
+#include <set>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+// Runs experiment repeats on a pool of pinned worker threads.
+//
+// Work is submitted in groups: a group is `repeats` independent jobs plus a
+// finish callback that receives all of their results. Finish callbacks run in
+// submission order, whatever order the jobs complete in, so CSV rows come out
+// identical to a serial run.
+//
+// Parallel mode starts one worker per physical core (SMT siblings are left
+// idle so timed loops do not share a core). Quiet mode runs every job on the
+// calling thread, one after another, for timing-only sweeps.
+class ExperimentScheduler {
+public:
+    enum class Mode { Quiet, Parallel };
+
+    explicit ExperimentScheduler(Mode mode, unsigned max_workers = 0) : mode_(mode) {
+        if (mode_ == Mode::Quiet) return;
+
+        vector<int> cpus = physicalCores();
+        if (max_workers != 0 && cpus.size() > max_workers) cpus.resize(max_workers);
+        for (int cpu : cpus) {
+            workers_.emplace_back([this, cpu] {
+                pinToCpu(cpu);
+                workerLoop();
+            });
+        }
+    }
+
+    ~ExperimentScheduler() {
+        drain();
+        {
+            lock_guard<mutex> lock(m_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& w : workers_) w.join();
+    }
+
+    ExperimentScheduler(const ExperimentScheduler&) = delete;
+    ExperimentScheduler& operator=(const ExperimentScheduler&) = delete;
+
+    [[nodiscard]] Mode mode() const { return mode_; }
+    [[nodiscard]] size_t workers() const { return workers_.empty() ? 1 : workers_.size(); }
+
+    template<typename R>
+    void submit(size_t repeats, function<R(size_t)> job, function<void(vector<R>&)> finish) {
+        auto results = make_shared<vector<R>>(repeats);
+
+        if (mode_ == Mode::Quiet || workers_.empty()) {
+            for (size_t r = 0; r < repeats; ++r) (*results)[r] = job(r);
+            finish(*results);
+            return;
+        }
+
+        auto group = make_shared<Group>();
+        group->remaining = repeats;
+        group->finish = [results, finish = std::move(finish)]() { finish(*results); };
+
+        {
+            lock_guard<mutex> lock(m_);
+            group->seq = next_seq_++;
+            pending_groups_.emplace_back(group);
+            for (size_t r = 0; r < repeats; ++r) {
+                queue_.emplace_back(group, [results, job, r]() { (*results)[r] = job(r); });
+            }
+        }
+        cv_.notify_all();
+        if (repeats == 0) completeOne(group, false);
+    }
+
+    // Blocks until every submitted group has finished.
+    void drain() {
+        unique_lock<mutex> lock(m_);
+        done_cv_.wait(lock, [&] { return pending_groups_.empty(); });
+    }
+
+    // One logical CPU per physical core. Falls back to every logical CPU when
+    // the topology cannot be read.
+    static vector<int> physicalCores() {
+        const unsigned n = thread::hardware_concurrency() ? thread::hardware_concurrency() : 1;
+        vector<int> cpus;
+#if defined(__linux__)
+        set<pair<int, int>> seen;
+        for (unsigned cpu = 0; cpu < n; ++cpu) {
+            const string base = "/sys/devices/system/cpu/cpu" + to_string(cpu) + "/topology/";
+            ifstream core_f(base + "core_id");
+            ifstream pkg_f(base + "physical_package_id");
+            int core = -1, pkg = -1;
+            if (!(core_f >> core) || !(pkg_f >> pkg)) {
+                cpus.clear();
+                break;
+            }
+            if (seen.insert({pkg, core}).second) cpus.push_back(static_cast<int>(cpu));
+        }
+#endif
+        if (cpus.empty()) {
+            for (unsigned cpu = 0; cpu < n; ++cpu) cpus.push_back(static_cast<int>(cpu));
+        }
+        return cpus;
+    }
+
+    static void pinToCpu(int cpu) {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#elif defined(_WIN32)
+        if (cpu < 64) SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu);
+#else
+        (void)cpu;
+#endif
+    }
+
+private:
+    struct Group {
+        size_t seq{0};
+        size_t remaining{0};
+        bool done{false};
+        function<void()> finish;
+    };
+
+    Mode mode_;
+    vector<thread> workers_;
+
+    mutex m_;
+    condition_variable cv_;
+    condition_variable done_cv_;
+    deque<pair<shared_ptr<Group>, function<void()>>> queue_;
+    deque<shared_ptr<Group>> pending_groups_;
+    size_t next_seq_{0};
+    bool stop_{false};
+    bool flushing_{false};
+
+    void workerLoop() {
+        while (true) {
+            pair<shared_ptr<Group>, function<void()>> item;
+            {
+                unique_lock<mutex> lock(m_);
+                cv_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                item = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            item.second();
+            completeOne(item.first, true);
+        }
+    }
+
+    // Marks one job of the group done, then runs finish callbacks for the
+    // longest completed prefix of groups. Only one thread flushes at a time.
+    void completeOne(const shared_ptr<Group>& group, bool count_job) {
+        unique_lock<mutex> lock(m_);
+        if (count_job) --group->remaining;
+        if (group->remaining == 0) group->done = true;
+        if (flushing_) return;
+
+        flushing_ = true;
+        while (!pending_groups_.empty() && pending_groups_.front()->done) {
+            shared_ptr<Group> g = pending_groups_.front();
+            lock.unlock();
+            g->finish();
+            lock.lock();
+            pending_groups_.pop_front();
+        }
+        flushing_ = false;
+        lock.unlock();
+        done_cv_.notify_all();
+    }
+};
+
+#endif //EXPERIMENTSCHEDULER_H
@@ -0,0 +1,148 @@
+
+#ifndef FUSEDINGEST_H
+#define FUSEDINGEST_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "../heavy/SketchHH.h"
+#include "../heavy/CMSSOHH.h"
+#include "../heavy/CSSOHH.h"
+#include "../sketch/Sketch.h"
+
+using namespace std;
+
+// Feeds one stream to several engines in a single pass.
+//
+// The stream is cut into blocks. For each block, every distinct hash seed
+// of the Count-Min and Count sketches (a "lane") is hashed once per item and
+// row; then each engine runs over the block, the sketch engines reading
+// their row hashes from the lanes instead of hashing, the others through
+// plain update() calls. A CMSSOHH and a CSSOHH built with the same seed
+// share a lane, and so do engines of one kind built alike. A block and its
+// lanes stay in L1/L2 while the engines take turns, so the stream is read
+// from memory once whatever the number of engines, and each engine's state
+// stays warm for a whole block.
+//
+// Every engine sees the items in stream order, so it ends in the state
+// separate passes would leave. Engines are borrowed, not owned, and may be
+// reset() between ingest() calls: lanes follow their new seeds.
+class FusedIngest {
+public:
+    static constexpr size_t DEFAULT_BLOCK = 256;
+
+    explicit FusedIngest(size_t block = DEFAULT_BLOCK) : block_(block ? block : 1) {}
+
+    void add(CMSSOHH& engine) {
+        cm_.push_back({&engine, lane(engine.hash_seed(), engine.rows())});
+    }
+
+    void add(CSSOHH& engine) {
+        cs_.push_back({&engine, lane(engine.index_seed(), engine.rows()), lane(engine.sign_seed(), engine.rows())});
+    }
+
+    void add(SketchHH& engine) { plain_.push_back(&engine); }
+
+    void ingest(const int* items, size_t n) {
+        refreshLanes();
+        for (size_t at = 0; at < n; at += block_) {
+            const size_t m = min(block_, n - at);
+            const int* block = items + at;
+
+            for (Lane& l : lanes_) {
+                // Locals, so the stores to h cannot alias them and the row
+                // loop vectorises.
+                const uint32_t seed = l.seed;
+                const int rows = l.rows;
+                l.hashes.resize(block_ * rows);
+                uint32_t* h = l.hashes.data();
+                for (size_t j = 0; j < m; ++j, h += rows) {
+                    const int item = block[j];
+                    for (int r = 0; r < rows; ++r) h[r] = Sketch::hash(item, seed + r);
+                }
+            }
+
+            for (const CountMin& e : cm_) {
+                const Lane& l = lanes_[e.lane];
+                for (size_t j = 0; j < m; ++j) e.engine->update_hashed(block[j], &l.hashes[j * l.rows]);
+            }
+            for (const Count& e : cs_) {
+                const Lane& li = lanes_[e.index_lane];
+                const Lane& ls = lanes_[e.sign_lane];
+                for (size_t j = 0; j < m; ++j) {
+                    e.engine->update_hashed(block[j], &li.hashes[j * li.rows], &ls.hashes[j * ls.rows]);
+                }
+            }
+            for (SketchHH* e : plain_) {
+                for (size_t j = 0; j < m; ++j) e->update(block[j]);
+            }
+        }
+    }
+
+    void ingest(const vector<int>& items) { ingest(items.data(), items.size()); }
+
+    // Distinct seeds hashed, and hashes computed per item over all of them.
+    [[nodiscard]] size_t lanes() const { return lanes_.size(); }
+    [[nodiscard]] size_t hashes_per_item() const {
+        size_t n = 0;
+        for (const Lane& l : lanes_) n += l.rows;
+        return n;
+    }
+
+private:
+    struct Lane {
+        uint32_t seed;
+        int rows;
+        vector<uint32_t> hashes;  // block x rows
+    };
+
+    struct CountMin {
+        CMSSOHH* engine;
+        size_t lane;
+    };
+
+    struct Count {
+        CSSOHH* engine;
+        size_t index_lane;
+        size_t sign_lane;
+    };
+
+    size_t block_;
+    vector<Lane> lanes_;
+    vector<CountMin> cm_;
+    vector<Count> cs_;
+    vector<SketchHH*> plain_;
+
+    // reset(seed) moves an engine to new hash seeds after add(); re-read
+    // them so no lane hashes with a stale seed.
+    void refreshLanes() {
+        bool stale = false;
+        for (const CountMin& e : cm_) stale |= lanes_[e.lane].seed != e.engine->hash_seed();
+        for (const Count& e : cs_) {
+            stale |= lanes_[e.index_lane].seed != e.engine->index_seed()
+                  || lanes_[e.sign_lane].seed != e.engine->sign_seed();
+        }
+        if (!stale) return;
+
+        lanes_.clear();
+        for (CountMin& e : cm_) e.lane = lane(e.engine->hash_seed(), e.engine->rows());
+        for (Count& e : cs_) {
+            e.index_lane = lane(e.engine->index_seed(), e.engine->rows());
+            e.sign_lane = lane(e.engine->sign_seed(), e.engine->rows());
+        }
+    }
+
+    size_t lane(uint32_t seed, int rows) {
+        for (size_t i = 0; i < lanes_.size(); ++i) {
+            if (lanes_[i].seed == seed) {
+                lanes_[i].rows = max(lanes_[i].rows, rows);
+                return i;
+            }
+        }
+        lanes_.push_back({seed, rows, {}});
+        return lanes_.size() - 1;
+    }
+};
+
+#endif //FUSEDINGEST_H
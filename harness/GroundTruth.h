@@ -0,0 +1,96 @@
+
+#ifndef GROUNDTRUTH_H
+#define GROUNDTRUTH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <algorithm>
+
+using namespace std;
+
+// Exact frequencies of a stream, computed once with an LSD radix sort and
+// shared by every engine and repeat that runs on that stream.
+//
+// Counts are stored as parallel key/count arrays sorted by key; the true
+// heavy-hitter set for each k is derived on first use and cached.
+class GroundTruth {
+public:
+    explicit GroundTruth(const vector<int>& stream) : f1_(stream.size()) {
+        vector<uint32_t> sorted = radixSort(stream);
+
+        for (size_t i = 0; i < sorted.size();) {
+            size_t j = i + 1;
+            while (j < sorted.size() && sorted[j] == sorted[i]) ++j;
+            keys_.push_back(static_cast<int>(sorted[i] ^ 0x80000000u));
+            counts_.push_back(static_cast<int>(j - i));
+            i = j;
+        }
+    }
+
+    [[nodiscard]] size_t F1() const { return f1_; }
+    [[nodiscard]] size_t distinct() const { return keys_.size(); }
+
+    // Exact count of item, 0 if it never occurs.
+    [[nodiscard]] int count(int item) const {
+        auto it = lower_bound(keys_.begin(), keys_.end(), item);
+        if (it == keys_.end() || *it != item) return 0;
+        return counts_[static_cast<size_t>(it - keys_.begin())];
+    }
+
+    // Items with count >= F1 / k, sorted by key.
+    const vector<int>& heavyHitters(int k) const {
+        lock_guard<mutex> lock(m_);
+        auto it = hh_.find(k);
+        if (it != hh_.end()) return it->second;
+
+        const double threshold = static_cast<double>(f1_) / k;
+        vector<int> hh;
+        for (size_t i = 0; i < keys_.size(); ++i) {
+            if (counts_[i] >= threshold) hh.push_back(keys_[i]);
+        }
+        return hh_.emplace(k, std::move(hh)).first->second;
+    }
+
+    [[nodiscard]] static bool contains(const vector<int>& sorted_keys, int item) {
+        return binary_search(sorted_keys.begin(), sorted_keys.end(), item);
+    }
+
+private:
+    size_t f1_;
+    vector<int> keys_;
+    vector<int> counts_;
+
+    mutable mutex m_;
+    mutable map<int, vector<int>> hh_;
+
+    // Sorts the stream as uint32 with the sign bit flipped so the order
+    // matches signed int order; two 16-bit passes.
+    static vector<uint32_t> radixSort(const vector<int>& stream) {
+        vector<uint32_t> a(stream.size());
+        vector<uint32_t> b(stream.size());
+        for (size_t i = 0; i < stream.size(); ++i) {
+            a[i] = static_cast<uint32_t>(stream[i]) ^ 0x80000000u;
+        }
+
+        vector<size_t> offsets(1u << 16);
+        for (int shift = 0; shift < 32; shift += 16) {
+            fill(offsets.begin(), offsets.end(), 0);
+            for (uint32_t v : a) ++offsets[(v >> shift) & 0xffff];
+            size_t sum = 0;
+            for (size_t& o : offsets) {
+                const size_t c = o;
+                o = sum;
+                sum += c;
+            }
+            for (uint32_t v : a) b[offsets[(v >> shift) & 0xffff]++] = v;
+            a.swap(b);
+        }
+        return a;
+    }
+};
+
+#endif //GROUNDTRUTH_H
@@ -0,0 +1,122 @@
+
+#ifndef INGESTPIPELINE_H
+#define INGESTPIPELINE_H
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "SpscRing.h"
+#include "../heavy/SketchHH.h"
+
+using namespace std;
+
+struct PipelineStats {
+    uint64_t items{0};
+    uint64_t batches{0};
+    double wall_ms{0.0};
+    double producer_stall_ms{0.0};       // loader waiting for a free slot
+    vector<double> consumer_stall_ms;    // per engine, waiting for input
+    vector<double> consumer_busy_ms;     // per engine, running updates
+    size_t ring_bytes{0};
+};
+
+// Streams keys from a loader thread to one consumer thread per engine.
+//
+// The source is called on the loader thread with a sink(const int*, size_t);
+// CsvIpReader::run and PcapReader::run both fit once wrapped in a lambda. The
+// sink packs keys into fixed-size batches of an SpscRing, and every consumer
+// feeds every batch to its own engine. Memory is bounded by the ring
+// (ring_batches * batch_items keys) whatever the length of the input, so a
+// named pipe or a growing file works as a live feed. Stall times show which
+// side limits throughput: a stalled loader means the engines are the
+// bottleneck, stalled consumers mean the input is.
+class IngestPipeline {
+public:
+    using Sink = function<void(const int*, size_t)>;
+    using Source = function<void(const Sink&)>;
+
+    static constexpr size_t DEFAULT_RING_BATCHES = 8;
+    static constexpr size_t DEFAULT_BATCH_ITEMS = 1u << 16;
+
+    explicit IngestPipeline(size_t ring_batches = DEFAULT_RING_BATCHES,
+                            size_t batch_items = DEFAULT_BATCH_ITEMS)
+        : ring_batches_(ring_batches), batch_items_(batch_items ? batch_items : 1) {}
+
+    PipelineStats run(const Source& source, const vector<SketchHH*>& engines) {
+        SpscRing<Batch> ring(ring_batches_, engines.size());
+        for (size_t i = 0; i < ring.slots(); ++i) ring.slot(i).keys.resize(batch_items_);
+
+        PipelineStats stats;
+        stats.ring_bytes = ring.slots() * batch_items_ * sizeof(int);
+        stats.consumer_stall_ms.assign(engines.size(), 0.0);
+        stats.consumer_busy_ms.assign(engines.size(), 0.0);
+
+        const auto start = chrono::steady_clock::now();
+
+        vector<thread> consumers;
+        consumers.reserve(engines.size());
+        for (size_t r = 0; r < engines.size(); ++r) {
+            consumers.emplace_back([&, r] {
+                SketchHH& engine = *engines[r];
+                chrono::steady_clock::duration busy{0};
+                while (const Batch* b = ring.next(r)) {
+                    const auto t0 = chrono::steady_clock::now();
+                    for (size_t i = 0; i < b->n; ++i) engine.update(b->keys[i]);
+                    busy += chrono::steady_clock::now() - t0;
+                    ring.release(r);
+                }
+                stats.consumer_busy_ms[r] = chrono::duration<double, milli>(busy).count();
+            });
+        }
+
+        thread loader([&] {
+            Batch* cur = ring.claim();
+            cur->n = 0;
+            source([&](const int* keys, size_t n) {
+                stats.items += n;
+                while (n > 0) {
+                    const size_t take = min(n, batch_items_ - cur->n);
+                    memcpy(cur->keys.data() + cur->n, keys, take * sizeof(int));
+                    cur->n += take;
+                    keys += take;
+                    n -= take;
+                    if (cur->n == batch_items_) {
+                        ring.publish();
+                        ++stats.batches;
+                        cur = ring.claim();
+                        cur->n = 0;
+                    }
+                }
+            });
+            if (cur->n > 0) {
+                ring.publish();
+                ++stats.batches;
+            }
+            ring.close();
+        });
+
+        loader.join();
+        for (auto& t : consumers) t.join();
+
+        stats.wall_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        stats.producer_stall_ms = ring.producerStallNs() / 1e6;
+        for (size_t r = 0; r < engines.size(); ++r) {
+            stats.consumer_stall_ms[r] = ring.readerStallNs(r) / 1e6;
+        }
+        return stats;
+    }
+
+private:
+    struct Batch {
+        vector<int> keys;
+        size_t n{0};
+    };
+
+    size_t ring_batches_;
+    size_t batch_items_;
+};
+
+#endif //INGESTPIPELINE_H
@@ -0,0 +1,113 @@
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <chrono>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define LATENCYHISTOGRAM_HAVE_TSC 1
+#endif
+
+using namespace std;
+
+// Log-bucketed latency histogram in the style of HdrHistogram.
+//
+// A value v is placed by its most significant bit and the SUB_BITS bits below
+// it, so every bucket spans at most 1/2^SUB_BITS of its lower bound (~6% with
+// the default of 4). Values are raw ticks from now(); percentiles are
+// converted to nanoseconds with a one-off calibration against steady_clock.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int NUM_BUCKETS = 64 * SUB_BUCKETS;
+
+    static uint64_t now() {
+#if defined(LATENCYHISTOGRAM_HAVE_TSC)
+        unsigned int aux;
+        return __rdtscp(&aux);
+#else
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    void record(uint64_t ticks) {
+        ++buckets_[bucketOf(ticks)];
+        ++count_;
+        if (ticks > max_) max_ = ticks;
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (int i = 0; i < NUM_BUCKETS; ++i) buckets_[i] += other.buckets_[i];
+        count_ += other.count_;
+        if (other.max_ > max_) max_ = other.max_;
+    }
+
+    [[nodiscard]] uint64_t count() const { return count_; }
+
+    // Upper bound of the bucket holding quantile q, in nanoseconds.
+    [[nodiscard]] double percentileNs(double q) const {
+        if (count_ == 0) return 0.0;
+        const auto rank = static_cast<uint64_t>(q * static_cast<double>(count_ - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < NUM_BUCKETS; ++i) {
+            seen += buckets_[i];
+            if (seen >= rank) {
+                const uint64_t upper = bucketUpper(i);
+                return static_cast<double>(upper < max_ ? upper : max_) / ticksPerNs();
+            }
+        }
+        return maxNs();
+    }
+
+    [[nodiscard]] double maxNs() const {
+        return static_cast<double>(max_) / ticksPerNs();
+    }
+
+    static double ticksPerNs() {
+        static const double rate = calibrate();
+        return rate;
+    }
+
+private:
+    array<uint64_t, NUM_BUCKETS> buckets_{};
+    uint64_t count_{0};
+    uint64_t max_{0};
+
+    static int bucketOf(uint64_t v) {
+        if (v < SUB_BUCKETS) return static_cast<int>(v);
+        const int msb = 63 - __builtin_clzll(v);
+        const int sub = static_cast<int>((v >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1));
+        return (msb - SUB_BITS + 1) * SUB_BUCKETS + sub;
+    }
+
+    static uint64_t bucketUpper(int idx) {
+        if (idx < SUB_BUCKETS) return static_cast<uint64_t>(idx);
+        const int msb = idx / SUB_BUCKETS + SUB_BITS - 1;
+        const uint64_t sub = static_cast<uint64_t>(idx % SUB_BUCKETS);
+        const uint64_t lower = (1ull << msb) | (sub << (msb - SUB_BITS));
+        return lower + (1ull << (msb - SUB_BITS)) - 1;
+    }
+
+    static double calibrate() {
+#if defined(LATENCYHISTOGRAM_HAVE_TSC)
+        const auto t0 = chrono::steady_clock::now();
+        const uint64_t c0 = now();
+        this_thread::sleep_for(chrono::milliseconds(20));
+        const auto t1 = chrono::steady_clock::now();
+        const uint64_t c1 = now();
+        const double ns = chrono::duration<double, nano>(t1 - t0).count();
+        return ns > 0.0 ? static_cast<double>(c1 - c0) / ns : 1.0;
+#else
+        return 1.0;
+#endif
+    }
+};
+
+#endif //LATENCYHISTOGRAM_H
@@ -0,0 +1,166 @@
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define PERFCOUNTERS_HAVE_TSC 1
+#endif
+
+using namespace std;
+
+// Totals for one measured region. Counters that could not be opened are NaN.
+struct PerfSample {
+    double cycles{numeric_limits<double>::quiet_NaN()};
+    double instructions{numeric_limits<double>::quiet_NaN()};
+    double llc_misses{numeric_limits<double>::quiet_NaN()};
+    double branch_misses{numeric_limits<double>::quiet_NaN()};
+    double dtlb_misses{numeric_limits<double>::quiet_NaN()};
+    bool tsc_cycles{false}; // cycles came from rdtsc rather than the PMU
+};
+
+// Hardware counters for the calling thread via perf_event_open.
+//
+// Each event is opened on its own so a missing event (common in VMs) does not
+// disable the others; counts are scaled by enabled/running time when the
+// kernel multiplexes. When the cycle counter is unavailable the time stamp
+// counter is used instead.
+class PerfCounters {
+public:
+    enum Event { CYCLES, INSTRUCTIONS, LLC_MISSES, BRANCH_MISSES, DTLB_MISSES, NUM_EVENTS };
+
+    PerfCounters() {
+#if defined(__linux__)
+        fds_[CYCLES]        = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        fds_[INSTRUCTIONS]  = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        fds_[LLC_MISSES]    = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        fds_[BRANCH_MISSES] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        fds_[DTLB_MISSES]   = open(PERF_TYPE_HW_CACHE,
+                                   PERF_COUNT_HW_CACHE_DTLB
+                                   | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                   | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#endif
+    }
+
+    ~PerfCounters() {
+#if defined(__linux__)
+        for (int fd : fds_) {
+            if (fd >= 0) close(fd);
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    [[nodiscard]] bool hardware() const {
+        for (int fd : fds_) {
+            if (fd >= 0) return true;
+        }
+        return false;
+    }
+
+    void start() {
+#if defined(__linux__)
+        for (int fd : fds_) {
+            if (fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        }
+        // RESET clears the count but not the enabled/running times, which
+        // keep growing from the first start(); scaling uses their deltas.
+        for (int i = 0; i < NUM_EVENTS; ++i) {
+            uint64_t buf[3];
+            if (readRaw(fds_[i], buf)) {
+                enabled_start_[i] = buf[1];
+                running_start_[i] = buf[2];
+            }
+        }
+        for (int fd : fds_) {
+            if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+        tsc_start_ = tsc();
+    }
+
+    PerfSample stop() {
+        const uint64_t tsc_end = tsc();
+        PerfSample s;
+#if defined(__linux__)
+        for (int fd : fds_) {
+            if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+        s.cycles        = read(CYCLES);
+        s.instructions  = read(INSTRUCTIONS);
+        s.llc_misses    = read(LLC_MISSES);
+        s.branch_misses = read(BRANCH_MISSES);
+        s.dtlb_misses   = read(DTLB_MISSES);
+#endif
+#if defined(PERFCOUNTERS_HAVE_TSC)
+        if (std::isnan(s.cycles)) {
+            s.cycles = static_cast<double>(tsc_end - tsc_start_);
+            s.tsc_cycles = true;
+        }
+#else
+        (void)tsc_end;
+#endif
+        return s;
+    }
+
+private:
+    int fds_[NUM_EVENTS]{-1, -1, -1, -1, -1};
+    uint64_t tsc_start_{0};
+    uint64_t enabled_start_[NUM_EVENTS]{};
+    uint64_t running_start_[NUM_EVENTS]{};
+
+    static uint64_t tsc() {
+#if defined(PERFCOUNTERS_HAVE_TSC)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+#if defined(__linux__)
+    static int open(uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    // Count, time enabled, time running.
+    static bool readRaw(int fd, uint64_t buf[3]) {
+        return fd >= 0 && ::read(fd, buf, 3 * sizeof(uint64_t)) == static_cast<ssize_t>(3 * sizeof(uint64_t));
+    }
+
+    // Count since start(), scaled by the share of the region the event ran.
+    [[nodiscard]] double read(int event) const {
+        uint64_t buf[3];
+        if (!readRaw(fds_[event], buf)) return numeric_limits<double>::quiet_NaN();
+        const uint64_t enabled = buf[1] - enabled_start_[event];
+        const uint64_t running = buf[2] - running_start_[event];
+        if (running == 0) return numeric_limits<double>::quiet_NaN();
+        return static_cast<double>(buf[0]) * static_cast<double>(enabled) / static_cast<double>(running);
+    }
+#endif
+};
+
+#endif //PERFCOUNTERS_H
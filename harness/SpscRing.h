@@ -0,0 +1,143 @@
+
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// Bounded lock-free ring of preallocated slots with one producer and a fixed
+// set of readers. Every reader sees every slot; each reader owns its own
+// cursor, so every producer/reader pair is a plain single-producer,
+// single-consumer queue and no compare-and-swap is needed. A slot is reused
+// once the slowest reader has released it.
+//
+// Waiting spins briefly and then blocks in atomic::wait, so an idle live
+// feed does not burn a core. Time spent blocked is accumulated per side and
+// reported as stall time.
+template<typename T>
+class SpscRing {
+public:
+    SpscRing(size_t slots, size_t readers)
+        : mask_(roundUp(slots) - 1), slots_(mask_ + 1), readers_(readers) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    [[nodiscard]] size_t slots() const { return slots_.size(); }
+    [[nodiscard]] size_t readers() const { return readers_.size(); }
+
+    // Direct slot access, e.g. to size slot buffers before the run starts.
+    T& slot(size_t i) { return slots_[i]; }
+
+    // Producer: returns the next free slot, waiting for the slowest reader
+    // if the ring is full. Call publish() once it is filled.
+    T* claim() {
+        const uint64_t head = head_.load(memory_order_relaxed);
+        if (head - min_tail_ >= slots_.size()) {
+            min_tail_ = minTail();
+            if (head - min_tail_ >= slots_.size()) {
+                const auto t0 = chrono::steady_clock::now();
+                do {
+                    waitReader(head);
+                    min_tail_ = minTail();
+                } while (head - min_tail_ >= slots_.size());
+                producer_stall_ns_ += elapsedNs(t0);
+            }
+        }
+        return &slots_[head & mask_];
+    }
+
+    void publish() {
+        head_.fetch_add(1, memory_order_release);
+        head_.notify_all();
+    }
+
+    // Producer: no more slots will be published.
+    void close() {
+        head_.fetch_or(CLOSED, memory_order_release);
+        head_.notify_all();
+    }
+
+    // Reader r: returns the next published slot, or nullptr once the
+    // producer has closed the ring and every slot has been read.
+    const T* next(size_t r) {
+        Cursor& c = readers_[r];
+        const uint64_t pos = c.pos.load(memory_order_relaxed);
+        uint64_t head = head_.load(memory_order_acquire);
+        if (pos >= (head & ~CLOSED) && !(head & CLOSED)) {
+            const auto t0 = chrono::steady_clock::now();
+            for (int spin = 0; pos >= (head & ~CLOSED) && !(head & CLOSED); ++spin) {
+                if (spin >= SPIN_LIMIT) head_.wait(head, memory_order_acquire);
+                head = head_.load(memory_order_acquire);
+            }
+            c.stall_ns += elapsedNs(t0);
+        }
+        if (pos >= (head & ~CLOSED)) return nullptr;
+        return &slots_[pos & mask_];
+    }
+
+    // Reader r: hands the slot returned by next(r) back to the producer.
+    void release(size_t r) {
+        Cursor& c = readers_[r];
+        c.pos.fetch_add(1, memory_order_release);
+        c.pos.notify_one();
+    }
+
+    [[nodiscard]] uint64_t producerStallNs() const { return producer_stall_ns_; }
+    [[nodiscard]] uint64_t readerStallNs(size_t r) const { return readers_[r].stall_ns; }
+
+private:
+    static constexpr uint64_t CLOSED = uint64_t{1} << 63;
+    static constexpr int SPIN_LIMIT = 256;
+
+    struct alignas(64) Cursor {
+        atomic<uint64_t> pos{0};
+        uint64_t stall_ns{0};
+    };
+
+    size_t mask_;
+    vector<T> slots_;
+    alignas(64) atomic<uint64_t> head_{0};
+    uint64_t min_tail_{0};          // producer-local cache of the slowest cursor
+    uint64_t producer_stall_ns_{0};
+    vector<Cursor> readers_;
+
+    static size_t roundUp(size_t n) {
+        size_t p = 2;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    static uint64_t elapsedNs(chrono::steady_clock::time_point t0) {
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now() - t0).count());
+    }
+
+    uint64_t minTail() const {
+        uint64_t m = UINT64_MAX;
+        for (const Cursor& c : readers_) m = min(m, c.pos.load(memory_order_acquire));
+        return readers_.empty() ? head_.load(memory_order_relaxed) & ~CLOSED : m;
+    }
+
+    // Blocks until the slowest reader moves past its current position.
+    void waitReader(uint64_t head) {
+        for (Cursor& c : readers_) {
+            const uint64_t pos = c.pos.load(memory_order_acquire);
+            if (head - pos < slots_.size()) continue;
+            for (int spin = 0; spin < SPIN_LIMIT; ++spin) {
+                if (c.pos.load(memory_order_acquire) != pos) return;
+            }
+            c.pos.wait(pos, memory_order_acquire);
+            return;
+        }
+    }
+};
+
+#endif //SPSCRING_H
@@ -116,6 +116,30 @@ FORCE_INLINE uint64_t fmix64 ( uint64_t k )
     return k;
 }
 
+//-----------------------------------------------------------------------------
+// MurmurHash3_x86_32 of a single 4-byte key, same result as
+// MurmurHash3_x86_32(&key, 4, seed, &out). Sketch rows hash one key per row
+// per item; the generic version is not always inlined and pays a call and
+// the length loop each time.
+
+FORCE_INLINE uint32_t MurmurHash3_x86_32_u32 ( uint32_t key, uint32_t seed )
+{
+    uint32_t h1 = seed;
+    uint32_t k1 = key;
+
+    k1 *= 0xcc9e2d51;
+    k1 = ROTL32(k1,15);
+    k1 *= 0x1b873593;
+
+    h1 ^= k1;
+    h1 = ROTL32(h1,13);
+    h1 = h1*5+0xe6546b64;
+
+    h1 ^= 4;
+
+    return fmix32(h1);
+}
+
 //-----------------------------------------------------------------------------
 
 void MurmurHash3_x86_32 ( const void * key, int len,
@@ -0,0 +1,120 @@
+
+#ifndef CANDIDATESTORE_H
+#define CANDIDATESTORE_H
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "IndexMinHeap.h"
+#include "FlatMinStore.h"
+#include "../help/CountingAllocator.h"
+#include "../help/Snapshot.h"
+
+// Candidate set of the sketch-based engines: the tilde_k keys with the
+// largest estimates seen so far.
+//
+// Two layouts share the interface. IndexMinHeap finds a key through a hash
+// map and keeps a binary heap; FlatMinStore scans a flat key array with SIMD
+// compares and caches the position of the minimum. On Zipf candidate traffic
+// the flat layout wins up to a few hundred keys and the heap beyond (see
+// bench_heap, "CandidateStore::offer"). Auto picks by capacity.
+enum class CandidatePolicy { Auto, Heap, Flat };
+
+class CandidateStore {
+public:
+    using Pair = std::pair<int, double>;
+
+    // Largest capacity for which Auto picks the flat layout.
+    static constexpr size_t FLAT_MAX_CAPACITY = 256;
+
+    // monotone: a key's estimate never decreases between offers, as with
+    // Count-Min. Then an estimate at or below the minimum of a full store
+    // cannot change it, so offer() skips the key lookup.
+    explicit CandidateStore(size_t capacity, CandidatePolicy policy = CandidatePolicy::Auto, bool monotone = false)
+        : monotone_(monotone) {
+        if (useFlat(capacity, policy)) flat_ = std::make_unique<FlatMinStore>(capacity);
+        else heap_ = std::make_unique<IndexMinHeap<int, double>>(capacity);
+    }
+
+    CandidateStore(const CandidateStore&) = delete;
+    CandidateStore& operator=(const CandidateStore&) = delete;
+
+    static bool useFlat(size_t capacity, CandidatePolicy policy) {
+        if (policy == CandidatePolicy::Auto) return capacity <= FLAT_MAX_CAPACITY;
+        return policy == CandidatePolicy::Flat;
+    }
+
+    [[nodiscard]] CandidatePolicy policy() const { return flat_ ? CandidatePolicy::Flat : CandidatePolicy::Heap; }
+
+    // Updates key if present, inserts it while there is room, and otherwise
+    // replaces the minimum if val exceeds it.
+    void offer(int key, double val) {
+        if (flat_) offerTo(*flat_, key, val);
+        else offerTo(*heap_, key, val);
+    }
+
+    [[nodiscard]] bool contains(int key) const { return flat_ ? flat_->contains(key) : heap_->contains(key); }
+    [[nodiscard]] size_t size() const { return flat_ ? flat_->size() : heap_->size(); }
+    [[nodiscard]] size_t capacity() const { return flat_ ? flat_->capacity() : heap_->capacity(); }
+    [[nodiscard]] bool full() const { return flat_ ? flat_->full() : heap_->full(); }
+
+    // Empties the store, keeping its layout and memory.
+    void clear() {
+        if (flat_) flat_->clear();
+        else heap_->clear();
+    }
+
+    [[nodiscard]] std::vector<Pair> items() const { return flat_ ? flat_->items() : heap_->items(); }
+
+    MemoryBreakdown memory_breakdown() const {
+        return flat_ ? flat_->memory_breakdown() : heap_->memory_breakdown();
+    }
+
+    // Both layouts write the IndexMinHeap section, so snapshots do not
+    // depend on the policy.
+    void save(SnapshotWriter& w) const {
+        if (flat_) flat_->save(w);
+        else heap_->save(w);
+    }
+
+    // Replaces the contents; the layout is picked again from the stored
+    // capacity under Auto.
+    bool load(SnapshotReader& r, CandidatePolicy policy = CandidatePolicy::Auto) {
+        SnapshotReader peek = r;
+        if (!peek.section(SnapshotKind::IndexMinHeap)) return false;
+        const auto capacity = peek.get<uint64_t>();
+
+        heap_.reset();
+        flat_.reset();
+        if (useFlat(capacity, policy)) {
+            flat_ = std::make_unique<FlatMinStore>(0);
+            return flat_->load(r);
+        }
+        heap_ = std::make_unique<IndexMinHeap<int, double>>(0);
+        return heap_->load(r);
+    }
+
+private:
+    std::unique_ptr<IndexMinHeap<int, double>> heap_;
+    std::unique_ptr<FlatMinStore> flat_;
+    bool monotone_;
+
+    template<typename Store>
+    void offerTo(Store& s, int key, double val) {
+        if (monotone_ && s.full() && val <= s.min_value()) return;
+        if constexpr (std::is_same_v<Store, FlatMinStore>) {
+            const long idx = s.find(key);
+            if (idx >= 0) s.update_at(static_cast<size_t>(idx), val);
+            else if (!s.full()) s.insert(key, val);
+            else if (val > s.min_value()) s.replace_top(key, val);
+        } else {
+            if (s.contains(key)) s.update(key, val);
+            else if (!s.full()) s.insert(key, val);
+            else if (val > s.min_value()) s.replace_top(key, val);
+        }
+    }
+};
+
+#endif //CANDIDATESTORE_H
@@ -0,0 +1,221 @@
+
+#ifndef FLATMINSTORE_H
+#define FLATMINSTORE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "../help/CountingAllocator.h"
+#include "../help/Snapshot.h"
+
+// Bounded min-store of (key, value) pairs as two flat arrays, for small
+// capacities where a linear SIMD key scan beats hashing into the index of
+// IndexMinHeap. The position of the minimum is cached and only recomputed
+// after the minimum itself was raised or replaced.
+//
+// Keys must be 32-bit integers for the SIMD scan.
+class FlatMinStore {
+public:
+    using Pair = std::pair<int, double>;
+
+    explicit FlatMinStore(size_t capacity)
+        : cap(capacity), keys((capacity + 7) / 8 * 8), vals(capacity) {}
+
+    size_t size() const { return n; }
+    size_t capacity() const { return cap; }
+    bool full() const { return n >= cap; }
+
+    // Slot holding key, or -1. Compares are gathered into one 64-bit mask per
+    // 64 keys, so there is one (rarely taken) branch per chunk instead of a
+    // hard-to-predict exit per vector.
+    long find(int key) const { return scan(keys.data(), n, key); }
+
+    // find() over any key array readable up to n rounded up to 8 entries.
+    static long scan(const int* k, size_t n, int key) {
+        const size_t padded = (n + 7) / 8 * 8;
+        for (size_t base = 0; base < padded; base += 64) {
+            const size_t end = std::min(padded, base + 64);
+            uint64_t mask = 0;
+#if defined(__AVX2__)
+            const __m256i needle = _mm256_set1_epi32(key);
+            for (size_t i = base; i < end; i += 8) {
+                const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(k + i));
+                mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_ps(
+                    _mm256_castsi256_ps(_mm256_cmpeq_epi32(block, needle))))) << (i - base);
+            }
+#elif defined(__SSE2__)
+            const __m128i needle = _mm_set1_epi32(key);
+            for (size_t i = base; i < end; i += 4) {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(k + i));
+                mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_ps(
+                    _mm_castsi128_ps(_mm_cmpeq_epi32(block, needle))))) << (i - base);
+            }
+#else
+            for (size_t i = base; i < end; ++i) mask |= static_cast<uint64_t>(k[i] == key) << (i - base);
+#endif
+            // Lanes past n are padding.
+            if (n - base < 64) mask &= (uint64_t{1} << (n - base)) - 1;
+            if (mask) return static_cast<long>(base + __builtin_ctzll(mask));
+        }
+        return -1;
+    }
+
+    bool contains(int key) const { return find(key) >= 0; }
+
+    void clear() {
+        n = 0;
+        min_valid = false;
+    }
+
+    Pair top() const {
+        if (n == 0) throw std::runtime_error("Store empty");
+        refreshMin();
+        return {keys[min_idx], vals[min_idx]};
+    }
+
+    double min_value() const {
+        if (n == 0) throw std::runtime_error("Store empty");
+        refreshMin();
+        return vals[min_idx];
+    }
+
+    void insert(int key, double val) {
+        if (full()) throw std::runtime_error("Store full");
+        keys[n] = key;
+        vals[n] = val;
+        if (min_valid && val < vals[min_idx]) min_idx = n;
+        if (n == 0) {
+            min_idx = 0;
+            min_valid = true;
+        }
+        ++n;
+    }
+
+    void update_at(size_t idx, double val) {
+        const double old = vals[idx];
+        vals[idx] = val;
+        if (min_valid) {
+            if (idx == min_idx) {
+                if (val > old) min_valid = false;
+            } else if (val < vals[min_idx]) {
+                min_idx = idx;
+            }
+        }
+        // Move the key halfway to the front, so frequent keys settle in the
+        // first chunk of find().
+        if (idx >= 64) {
+            const size_t to = idx / 2;
+            std::swap(keys[idx], keys[to]);
+            std::swap(vals[idx], vals[to]);
+            if (min_idx == idx) min_idx = to;
+            else if (min_idx == to) min_idx = idx;
+        }
+    }
+
+    void update(int key, double val) {
+        const long idx = find(key);
+        if (idx >= 0) update_at(static_cast<size_t>(idx), val);
+    }
+
+    void replace_top(int key, double val) {
+        if (n == 0) {
+            insert(key, val);
+            return;
+        }
+        refreshMin();
+        keys[min_idx] = key;
+        vals[min_idx] = val;
+        min_valid = false;
+    }
+
+    std::vector<Pair> items() const {
+        std::vector<Pair> out;
+        out.reserve(n);
+        for (size_t i = 0; i < n; ++i) out.emplace_back(keys[i], vals[i]);
+        return out;
+    }
+
+    MemoryBreakdown memory_breakdown() const {
+        MemoryBreakdown m;
+        m.add("keys", vectorBytes(keys));
+        m.add("values", vectorBytes(vals));
+        return m;
+    }
+
+    // Same section as IndexMinHeap::save(). Entries are written in ascending
+    // value order, which is a valid heap order, so either store can load it.
+    void save(SnapshotWriter& w) const {
+        std::vector<size_t> order(n);
+        std::iota(order.begin(), order.end(), size_t{0});
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return vals[a] < vals[b]; });
+        std::vector<int> k;
+        std::vector<double> v;
+        k.reserve(n);
+        v.reserve(n);
+        for (size_t i : order) {
+            k.push_back(keys[i]);
+            v.push_back(vals[i]);
+        }
+
+        const size_t at = w.beginSection(SnapshotKind::IndexMinHeap);
+        w.put<uint64_t>(cap);
+        w.put<uint64_t>(n);
+        w.putArray(k.data(), k.size());
+        w.putArray(v.data(), v.size());
+        w.endSection(at);
+    }
+
+    bool load(SnapshotReader& r) {
+        if (!r.section(SnapshotKind::IndexMinHeap)) return false;
+        const auto c = r.get<uint64_t>();
+        const auto count = r.get<uint64_t>();
+        if (!r.ok() || count > c) return false;
+
+        cap = c;
+        keys.assign((c + 7) / 8 * 8, 0);
+        vals.assign(c, 0.0);
+        if (!r.getArray(keys.data(), count) || !r.getArray(vals.data(), count)) return false;
+        n = count;
+        min_valid = false;
+        return true;
+    }
+
+private:
+    size_t cap;
+    size_t n{0};
+    std::vector<int> keys;      // padded to a multiple of 8 for the SIMD scan
+    std::vector<double> vals;
+    mutable size_t min_idx{0};
+    mutable bool min_valid{false};
+
+    void refreshMin() const {
+        if (min_valid) return;
+        // Vector min first, then the first slot holding it.
+        const double* v = vals.data();
+        double best_val = v[0];
+        size_t i = 0;
+#if defined(__AVX2__)
+        __m256d m = _mm256_set1_pd(best_val);
+        for (; i + 4 <= n; i += 4) m = _mm256_min_pd(m, _mm256_loadu_pd(v + i));
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, m);
+        best_val = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+#endif
+        for (; i < n; ++i) best_val = std::min(best_val, v[i]);
+
+        size_t best = 0;
+        while (v[best] != best_val) ++best;
+        min_idx = best;
+        min_valid = true;
+    }
+};
+
+#endif //FLATMINSTORE_H
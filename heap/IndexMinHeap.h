@@ -8,18 +8,32 @@
 #include <utility>
 #include <stdexcept>
 
+#include "../help/CountingAllocator.h"
+#include "../help/Snapshot.h"
+
 template<typename KeyT, typename ValT>
 class IndexMinHeap {
 public:
     using Pair = std::pair<KeyT, ValT>;
 
-    explicit IndexMinHeap(size_t capacity) : cap(capacity) {}
+    explicit IndexMinHeap(size_t capacity)
+        : cap(capacity), index_map(0, std::hash<KeyT>(), std::equal_to<KeyT>(), IndexAlloc(&index_bytes)) {}
+
+    IndexMinHeap(const IndexMinHeap&) = delete;
+    IndexMinHeap& operator=(const IndexMinHeap&) = delete;
 
     bool contains(const KeyT& key) const {
         return index_map.find(key) != index_map.end();
     }
 
+    // Value of key, or nullptr if absent.
+    const ValT* find(const KeyT& key) const {
+        auto it = index_map.find(key);
+        return it == index_map.end() ? nullptr : &heap[it->second].second;
+    }
+
     size_t size() const { return heap.size(); }
+    size_t capacity() const { return cap; }
     bool full() const { return heap.size() >= cap; }
 
     const Pair& top() const {
@@ -34,6 +48,61 @@ public:
 
     const std::vector<Pair>& items() const { return heap; }
 
+    // Empties the heap; the entry array and index buckets are kept.
+    void clear() {
+        heap.clear();
+        index_map.clear();
+    }
+
+    MemoryBreakdown memory_breakdown() const {
+        MemoryBreakdown m;
+        m.add("entries", vectorBytes(heap));
+        m.add("index", index_bytes);
+        return m;
+    }
+
+    // Keys and values are written as two aligned arrays in heap order, so the
+    // heap property holds on load and only the index has to be rebuilt.
+    void save(SnapshotWriter& w) const {
+        const size_t at = w.beginSection(SnapshotKind::IndexMinHeap);
+        w.put<uint64_t>(cap);
+        w.put<uint64_t>(heap.size());
+        std::vector<KeyT> keys;
+        std::vector<ValT> vals;
+        keys.reserve(heap.size());
+        vals.reserve(heap.size());
+        for (const Pair& p : heap) {
+            keys.push_back(p.first);
+            vals.push_back(p.second);
+        }
+        w.putArray(keys.data(), keys.size());
+        w.putArray(vals.data(), vals.size());
+        w.endSection(at);
+    }
+
+    // Replaces the contents of this heap; returns false on a bad snapshot.
+    bool load(SnapshotReader& r) {
+        if (!r.section(SnapshotKind::IndexMinHeap)) return false;
+        const auto c = r.get<uint64_t>();
+        const auto n = r.get<uint64_t>();
+        if (!r.ok() || n > c) return false;
+
+        std::vector<KeyT> keys(n);
+        std::vector<ValT> vals(n);
+        if (!r.getArray(keys.data(), n) || !r.getArray(vals.data(), n)) return false;
+
+        cap = c;
+        heap.clear();
+        heap.reserve(n);
+        index_map.clear();
+        index_map.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            heap.emplace_back(keys[i], vals[i]);
+            index_map[keys[i]] = static_cast<int>(i);
+        }
+        return true;
+    }
+
     void insert(const KeyT& key, ValT val) {
         if (contains(key)) {
             update(key, val);
@@ -67,9 +136,12 @@ public:
     }
 
 private:
+    using IndexAlloc = CountingAllocator<std::pair<const KeyT, int>>;
+
     size_t cap;
+    size_t index_bytes{0};
     std::vector<Pair> heap;                 // binary heap
-    std::unordered_map<KeyT, int> index_map; // key → heap index
+    std::unordered_map<KeyT, int, std::hash<KeyT>, std::equal_to<KeyT>, IndexAlloc> index_map; // key → heap index
 
     void swap_nodes(int i, int j) {
         std::swap(heap[i], heap[j]);
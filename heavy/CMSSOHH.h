@@ -5,10 +5,14 @@
 
 #include <vector>
 #include <utility>
+#include <memory>
+#include <optional>
 #include "../sketch/CMS.h"
 #include "sketchHH.h"
-#include "../heap/IndexMinHeap.h"
+#include "../heap/CandidateStore.h"
 #include "../sketch/CMSSO.h"
+#include "ElasticFront.h"
+#include "PacketSampler.h"
 using namespace std;
 
 class CMSSOHH : public SketchHH {
@@ -21,11 +25,49 @@ private:
     double eps_{1.0};
     double delta_{1e-6};
     CMSSO* sketch;
-    IndexMinHeap<int,double> heap;
+    CandidateStore heap;  // monotone: Count-Min estimates never decrease
+    ElasticFront* front_{nullptr};
+    PacketSampler sampler_;
+
+    // With a front end: the sketch with the front counts flushed in, rebuilt
+    // by released() on the first read after an update. Like the rest of the
+    // engine, not safe to read from several threads at once.
+    mutable optional<CMSSO> released_;
+    mutable bool released_stale_{true};
+
+    // Used by load(); the sketch and heap come from the snapshot.
+    CMSSOHH() : sketch(nullptr), heap(0, CandidatePolicy::Auto, true) {}
+
+    template<typename Estimate>
+    void ingest(int item, Estimate&& estimate) {
+        ++n_;
+        if (sampler_.sampling() && !sampler_.admit()) return;
+
+        double est;
+        if (front_) {
+            released_stale_ = true;
+            ElasticFront::Eviction ev;
+            bool admitted;
+            ElasticFront::Slot* slot = front_->insert(item, ev, admitted);
+            if (ev.happened) sketch->update(ev.key, static_cast<int>(ev.count));
+            if (slot) {
+                if (admitted) slot->base = ElasticFront::toBase(sketch->rank_query(item));
+                est = static_cast<double>(slot->base) + slot->count;
+            } else {
+                est = estimate();
+            }
+        } else {
+            est = estimate();
+        }
+
+        heap.offer(item, est);
+    }
 
 public:
-    CMSSOHH(int depth, double epsilon, double delta, int k, int tilde_k, uint32_t seed, size_t T)
-        : k_(k), tilde_k_(tilde_k),  eps_(epsilon), delta_(delta), heap(tilde_k) {
+    CMSSOHH(int depth, double epsilon, double delta, int k, int tilde_k, uint32_t seed, size_t T,
+            size_t front_buckets = 0, double sample_rate = 1.0,
+            CandidatePolicy candidates = CandidatePolicy::Auto, int counter_bits = 0)
+        : k_(k), tilde_k_(tilde_k),  eps_(epsilon), delta_(delta), heap(tilde_k, candidates, true), sampler_(sample_rate) {
         int min_d;
         min_d = static_cast<int>(log(4.0*(static_cast<double>(T)+tilde_k)/(delta_))) +1;
 
@@ -34,48 +76,157 @@ public:
         } else {
             depth_ = depth;
         }
-        sketch = new CMSSO(2*tilde_k, depth_, epsilon, seed);
+        sketch = new CMSSO(2*tilde_k, depth_, sampler_.sketchEps(epsilon), seed, counter_bits);
+        if (front_buckets) front_ = new ElasticFront(front_buckets);
     }
 
     ~CMSSOHH() override {
         delete sketch;
+        delete front_;
     }
 
     void update(int item) override {
-        ++n_;
+        ingest(item, [&] { return sketch->update_estimate(item, 1); });
+    }
+
+    // update() with the sketch row hashes of item precomputed, see
+    // CMSSO::update_estimate_hashed(); FusedIngest shares them between
+    // engines.
+    void update_hashed(int item, const uint32_t* h) {
+        ingest(item, [&] { return sketch->update_estimate_hashed(h, 1); });
+    }
 
-        double est = sketch->update_estimate(item, 1);
+    [[nodiscard]] uint32_t hash_seed() const { return sketch->hash_seed(); }
+    [[nodiscard]] int rows() const { return sketch->rows(); }
+
+    // Loaded engines reset too: the sketch gets its epsilon from here.
+    void reset(uint32_t seed) override {
+        n_ = 0;
+        sketch->reset(seed, sampler_.sketchEps(eps_));
+        heap.clear();
+        if (front_) front_->clear();
+        sampler_.reset();
+        released_stale_ = true;
+    }
 
-        if (heap.contains(item)) {
-            heap.update(item, est);
-        } else if (!heap.full()) {
-            heap.insert(item, est);
-        } else if (est > heap.min_value()) {
-            heap.replace_top(item, est);
+    // The table the plain engine would hold, which query() and estimate()
+    // read: the noisy sketch itself or, with a front end, a cached copy with
+    // every count still held by the front end flushed back in. Refreshing the
+    // cache copies into the buffers it already holds.
+    [[nodiscard]] const CMSSO& released() const {
+        if (!front_) return *sketch;
+        if (released_stale_) {
+            released_ = *sketch;
+            front_->for_each([&](int key, uint32_t count) {
+                released_->update(key, static_cast<int>(count));
+            });
+            released_stale_ = false;
         }
+        return *released_;
     }
 
+    // An owned copy of released().
+    [[nodiscard]] CMSSO releasedSketch() const { return released(); }
+
+    [[nodiscard]] const ElasticFront* front() const { return front_; }
+
     vector<pair<int, double>> query() const override {
         vector<pair<int,double>> out;
 
+        const CMSSO& released = this->released();
+
+        // Sampled counts are rescaled by 1/p; the noise, drawn at the
+        // amplified budget, is rescaled with them.
+        const double scale = 1.0 / sampler_.rate();
+
         double noise;
-        noise = (2.0 * depth_ / eps_) * log(4.0*depth_*static_cast<double>(tilde_k_) / delta_);
+        noise = (2.0 * depth_ / sampler_.sketchEps(eps_)) * log(4.0*depth_*static_cast<double>(tilde_k_) / delta_);
+        noise *= scale;
 
         const auto n_double = static_cast<double>(n_);
         const double tau_1 = n_double / static_cast<double>(k_);
-        const double tau_2 = 3*n_double / static_cast<double>(tilde_k_) + 1.0 + 3*noise;
+        const double tau_2 = 3*n_double / static_cast<double>(tilde_k_) + 1.0 + 3*noise
+                           + sampler_.samplingError(tau_1, delta_, static_cast<double>(tilde_k_));
         const double tau = max(tau_1, tau_2);
 
         // printf("noise: %.2f, tau_1: %.2f, tau_2 %.2f\n", noise, tau_1, tau_2);
 
         for (auto &p : heap.items()) {
-            double est = sketch->query(p.first);
-            if (p.second >= tau && est >= tau) {
-                out.push_back(p);
+            double est = released.query(p.first) * scale;
+            // With a front end or compact counters the heap scores are
+            // (partly) exact counts, so only the released estimate decides
+            // and is reported.
+            if (front_ || sketch->compact()) {
+                if (est >= tau) out.emplace_back(p.first, est);
+            } else if (p.second * scale >= tau && est >= tau) {
+                out.emplace_back(p.first, p.second * scale);
             }
         }
         return out;
     }
+
+    // The released sketch's estimate of any key, tracked or not, rescaled
+    // like query(). This is post-processing of the noisy table, so a lookup
+    // spends no budget beyond the table's own and needs no threshold. With a
+    // front end it reads released(), which only copies after an update.
+    [[nodiscard]] double estimate(int item) const override {
+        double out;
+        estimateBatch({&item, 1}, {&out, 1});
+        return out;
+    }
+
+    [[nodiscard]] size_t tracked_keys() const override {
+        return heap.capacity();
+    }
+
+    MemoryBreakdown memory_breakdown() const override {
+        MemoryBreakdown m;
+        m.add("object", sizeof(*this));
+        m.add("sketch", sketch->memory_breakdown());
+        m.add("heap", heap.memory_breakdown());
+        if (front_) m.add("front", front_->memory_breakdown());
+        return m;
+    }
+
+    // The noisy sketch is stored as is, so a reload draws no new noise and
+    // the privacy accounting of the original run carries over. Counts held
+    // by a front end are flushed into the stored sketch; the reloaded engine
+    // runs without one.
+    void save(SnapshotWriter& w) const {
+        const size_t at = w.beginSection(SnapshotKind::CMSSOHH);
+        w.put<uint64_t>(k_);
+        w.put<uint64_t>(tilde_k_);
+        w.put<uint64_t>(n_);
+        w.put<int32_t>(depth_);
+        w.put<double>(eps_);
+        w.put<double>(delta_);
+        w.put<double>(sampler_.rate());
+        released().save(w);
+        heap.save(w);
+        w.endSection(at);
+    }
+
+    static unique_ptr<CMSSOHH> load(SnapshotReader& r) {
+        if (!r.section(SnapshotKind::CMSSOHH)) return nullptr;
+        unique_ptr<CMSSOHH> out(new CMSSOHH());
+        out->k_ = r.get<uint64_t>();
+        out->tilde_k_ = r.get<uint64_t>();
+        out->n_ = r.get<uint64_t>();
+        out->depth_ = r.get<int32_t>();
+        out->eps_ = r.get<double>();
+        out->delta_ = r.get<double>();
+        out->sampler_ = PacketSampler(r.get<double>());
+        out->sketch = CMSSO::load(r).release();
+        if (!out->sketch || !out->heap.load(r)) return nullptr;
+        return out;
+    }
+
+protected:
+    void estimateBatch(span<const int> items, span<double> out) const override {
+        released().query_batch(items.data(), items.size(), out.data());
+        const double scale = 1.0 / sampler_.rate();
+        for (double& v : out) v *= scale;
+    }
 };
 
 #endif //CMSSSHH_H
@@ -0,0 +1,312 @@
+
+#ifndef CMSSOHHWINDOW_H
+#define CMSSOHHWINDOW_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+#include <utility>
+
+#include "SketchHH.h"
+#include "../heap/IndexMinHeap.h"
+#include "../sketch/Sketch.h"
+
+using namespace std;
+
+// Sliding-window CMSSOHH over the last `window` items.
+//
+// Each of the `num_sub_windows` sub-windows keeps an exact (noise-free)
+// Count-Min table with the shared hash seeds, and its own Laplace noise per
+// cell: the keyed draw laplaceNoiseAt(noise_key_, epoch * cells + cell),
+// where epoch numbers the sub-windows opened since the last reset. A single
+// noisy table holds the sum of the live sub-windows, counts and noise. Each
+// item lands in one sub-window, whose noisy table is eps-DP on its own, and
+// a release is a function of the noisy tables of complete sub-windows only.
+// Releases happen at rotate(), when the head sub-window is full and its
+// counts are final; query() and estimate() read the cached result. Two
+// releases therefore differ by whole sub-windows, each carrying noise of its
+// own, and overlapping windows compose in parallel: a key pays eps in total,
+// however many windows it is reported in. Releasing mid-sub-window would not
+// do: two releases sharing the head's noise differ by the exact count of the
+// items in between. Until the first rotate() nothing is released.
+//
+// Opening a sub-window (rotate()) releases the window that just closed, then
+// subtracts the expired sub-window's counts and noise from the noisy table
+// and adds the new one's noise, one pass over the table. The candidate heap
+// is re-scored against the new window after each expiry.
+class CMSSOHHWindow : public SketchHH {
+private:
+
+    size_t k_{0};
+    size_t tilde_k_{0};
+    int depth_{0};
+    int width_{0};
+    uint32_t seed_{0};
+    double eps_{1.0};
+    double delta_{1e-6};
+
+    static constexpr uint64_t NOT_OPENED = numeric_limits<uint64_t>::max();
+
+    size_t sub_len_{0};
+    size_t head_{0};
+    vector<size_t> counts_;
+    vector<vector<int32_t>> subs_;  // depth_ * width_ exact counts per sub-window
+    vector<uint64_t> epochs_;       // noise epoch per sub-window, NOT_OPENED if unused
+    uint64_t next_epoch_{0};
+    uint64_t noise_key_{0};
+    vector<double> noisy_;          // sum of subs_ and their noise
+    IndexMinHeap<int,double> heap;
+
+    [[nodiscard]] size_t cell(int row, int item) const {
+        return static_cast<size_t>(row) * width_ + Sketch::hash(item, seed_ + row) % width_;
+    }
+
+    [[nodiscard]] double cellNoise(uint64_t epoch, size_t c) const {
+        return Sketch::laplaceNoiseAt(noise_key_, epoch * noisy_.size() + c, eps_, 2*depth_);
+    }
+
+    // Fills sub-window s: a new epoch, and its noise added to every cell.
+    void open(size_t s) {
+        epochs_[s] = next_epoch_++;
+        for (size_t c = 0; c < noisy_.size(); ++c) noisy_[c] += cellNoise(epochs_[s], c);
+    }
+
+    // Starts over with a fresh noise key and only sub-window 0 open.
+    void clear() {
+        for (auto& sub : subs_) fill(sub.begin(), sub.end(), 0);
+        fill(counts_.begin(), counts_.end(), 0);
+        fill(epochs_.begin(), epochs_.end(), NOT_OPENED);
+        fill(noisy_.begin(), noisy_.end(), 0.0);
+        head_ = 0;
+        next_epoch_ = 0;
+        random_device rd;
+        noise_key_ = (static_cast<uint64_t>(rd()) << 32) | rd();
+        open(0);
+    }
+
+    // Tail bound on the noise of one cell: a sum of `live` Laplace(b) draws,
+    // b = 2 depth / eps, over all 4 depth tilde_k cells with failure
+    // probability delta. The smaller of a union bound over the draws and the
+    // sum-of-Laplace concentration bound (Chan, Shi and Song, 2011).
+    [[nodiscard]] double noiseBound() const {
+        size_t live = 0;
+        for (uint64_t e : epochs_) live += e != NOT_OPENED;
+        const double b = 2.0 * depth_ / eps_;
+        const double cells = 4.0 * depth_ * static_cast<double>(tilde_k_);
+        const auto l = static_cast<double>(max<size_t>(live, 1));
+        const double ln = log(2.0 * cells / delta_);
+        const double union_bound = l * b * log(l * cells / delta_);
+        const double sum_bound = 2.0 * sqrt(2.0) * b * max(sqrt(l), sqrt(ln)) * sqrt(ln);
+        return min(union_bound, sum_bound);
+    }
+
+    // Candidates over the current window that clear the threshold, scored on
+    // the noisy table.
+    [[nodiscard]] vector<pair<int, double>> release() const {
+        vector<pair<int,double>> out;
+
+        const double noise = noiseBound();
+
+        const auto n_double = static_cast<double>(window_count());
+        const double tau_1 = n_double / static_cast<double>(k_);
+        const double tau_2 = 3*n_double / static_cast<double>(tilde_k_) + 1.0 + 3*noise;
+        const double tau = max(tau_1, tau_2);
+
+        for (auto &p : heap.items()) {
+            double est = noisyEstimate(p.first);
+            if (p.second >= tau && est >= tau) {
+                out.emplace_back(p.first, est);
+            }
+        }
+        return out;
+    }
+
+    [[nodiscard]] double noisyEstimate(int item) const {
+        double est = numeric_limits<double>::max();
+        for (int i = 0; i < depth_; ++i) {
+            est = min(est, noisy_[cell(i, item)]);
+        }
+        return est;
+    }
+
+    // Used by load(); every field comes from the snapshot.
+    CMSSOHHWindow() : heap(0) {}
+
+public:
+    CMSSOHHWindow(int depth, double epsilon, double delta, int k, int tilde_k, uint32_t seed,
+                  size_t window, size_t num_sub_windows)
+        : k_(k), tilde_k_(tilde_k), seed_(seed), eps_(epsilon), delta_(delta),
+          sub_len_((window + num_sub_windows - 1) / num_sub_windows),
+          counts_(num_sub_windows, 0), heap(tilde_k) {
+        int min_d;
+        min_d = static_cast<int>(log(4.0*(static_cast<double>(window)+tilde_k)/(delta_))) +1;
+
+        if(depth < min_d) {
+            depth_ = min_d;
+        } else {
+            depth_ = depth;
+        }
+        width_ = 2 * tilde_k;
+
+        const size_t cells = static_cast<size_t>(depth_) * width_;
+        subs_.assign(num_sub_windows, vector<int32_t>(cells, 0));
+        epochs_.resize(num_sub_windows);
+        noisy_.resize(cells);
+        clear();
+    }
+
+    void reset(uint32_t seed) override {
+        seed_ = seed;
+        clear();
+        heap.clear();
+        last_release_.clear();
+    }
+
+    void update(int item) override {
+        if (sub_len_ != 0 && counts_[head_] >= sub_len_) {
+            rotate();
+        }
+        ++counts_[head_];
+
+        vector<int32_t>& sub = subs_[head_];
+        double est = numeric_limits<double>::max();
+        for (int i = 0; i < depth_; ++i) {
+            const size_t c = cell(i, item);
+            ++sub[c];
+            noisy_[c] += 1.0;
+            est = min(est, noisy_[c]);
+        }
+
+        if (heap.contains(item)) {
+            heap.update(item, est);
+        } else if (!heap.full()) {
+            heap.insert(item, est);
+        } else if (est > heap.min_value()) {
+            heap.replace_top(item, est);
+        }
+    }
+
+    // Releases the window that just closed, then starts a new sub-window,
+    // expiring the oldest one with its noise.
+    void rotate() {
+        recordRelease(release());
+
+        head_ = (head_ + 1) % subs_.size();
+        vector<int32_t>& expired = subs_[head_];
+        if (epochs_[head_] != NOT_OPENED) {
+            for (size_t c = 0; c < expired.size(); ++c) {
+                noisy_[c] -= expired[c] + cellNoise(epochs_[head_], c);
+            }
+        }
+        fill(expired.begin(), expired.end(), 0);
+        counts_[head_] = 0;
+        open(head_);
+
+        vector<int> candidates;
+        candidates.reserve(heap.size());
+        for (const auto& p : heap.items()) candidates.push_back(p.first);
+        for (int item : candidates) heap.update(item, noisyEstimate(item));
+    }
+
+    [[nodiscard]] size_t window_count() const {
+        size_t n = 0;
+        for (size_t c : counts_) n += c;
+        return n;
+    }
+
+    // Result of the release at the most recent rotate().
+    vector<pair<int, double>> query() const override {
+        return last_release_;
+    }
+
+    // The count the most recent release reported for item, else 0; see
+    // SketchHH. Reading the live noisy table instead would expose the exact
+    // count of the head sub-window between two calls.
+    [[nodiscard]] double estimate(int item) const override {
+        return releasedCount(item);
+    }
+
+    [[nodiscard]] size_t tracked_keys() const override {
+        return heap.capacity();
+    }
+
+    MemoryBreakdown memory_breakdown() const override {
+        size_t subs = vectorBytes(subs_) + vectorBytes(counts_);
+        for (const auto& s : subs_) subs += vectorBytes(s);
+
+        MemoryBreakdown m;
+        m.add("object", sizeof(*this));
+        m.add("sub_tables", subs + vectorBytes(epochs_));
+        m.add("noisy_table", vectorBytes(noisy_));
+        m.add("heap", heap.memory_breakdown());
+        return m;
+    }
+
+    // Stores the exact sub-window tables next to the noisy one, and the noise
+    // key: expiring a sub-window after a reload has to subtract the noise it
+    // was opened with. A snapshot is therefore as sensitive as the stream
+    // itself and must not be published. The last release is kept, so a
+    // reloaded engine answers query() as the original did.
+    void save(SnapshotWriter& w) const {
+        const size_t at = w.beginSection(SnapshotKind::CMSSOHHWindow);
+        w.put<uint64_t>(k_);
+        w.put<uint64_t>(tilde_k_);
+        w.put<int32_t>(depth_);
+        w.put<int32_t>(width_);
+        w.put<uint32_t>(seed_);
+        w.put<double>(eps_);
+        w.put<double>(delta_);
+        w.put<uint64_t>(sub_len_);
+        w.put<uint64_t>(head_);
+        w.put<uint64_t>(subs_.size());
+        w.put<uint64_t>(next_epoch_);
+        w.put<uint64_t>(noise_key_);
+        vector<uint64_t> counts(counts_.begin(), counts_.end());
+        w.putArray(counts.data(), counts.size());
+        w.putArray(epochs_.data(), epochs_.size());
+        for (const auto& sub : subs_) w.putArray(sub.data(), sub.size());
+        w.putArray(noisy_.data(), noisy_.size());
+        heap.save(w);
+        savePairs(w, last_release_);
+        w.endSection(at);
+    }
+
+    static unique_ptr<CMSSOHHWindow> load(SnapshotReader& r) {
+        if (!r.section(SnapshotKind::CMSSOHHWindow)) return nullptr;
+        unique_ptr<CMSSOHHWindow> out(new CMSSOHHWindow());
+        out->k_ = r.get<uint64_t>();
+        out->tilde_k_ = r.get<uint64_t>();
+        out->depth_ = r.get<int32_t>();
+        out->width_ = r.get<int32_t>();
+        out->seed_ = r.get<uint32_t>();
+        out->eps_ = r.get<double>();
+        out->delta_ = r.get<double>();
+        out->sub_len_ = r.get<uint64_t>();
+        out->head_ = r.get<uint64_t>();
+        const auto subs = r.get<uint64_t>();
+        out->next_epoch_ = r.get<uint64_t>();
+        out->noise_key_ = r.get<uint64_t>();
+        if (!r.ok() || subs == 0 || out->head_ >= subs || out->depth_ <= 0 || out->width_ <= 0) {
+            return nullptr;
+        }
+
+        const size_t cells = static_cast<size_t>(out->depth_) * out->width_;
+        vector<uint64_t> counts(subs);
+        out->epochs_.resize(subs);
+        out->subs_.assign(subs, vector<int32_t>(cells));
+        out->noisy_.resize(cells);
+        if (!r.getArray(counts.data(), subs) || !r.getArray(out->epochs_.data(), subs)) return nullptr;
+        for (auto& sub : out->subs_) {
+            if (!r.getArray(sub.data(), cells)) return nullptr;
+        }
+        if (!r.getArray(out->noisy_.data(), cells)) return nullptr;
+        out->counts_.assign(counts.begin(), counts.end());
+        if (!out->heap.load(r) || !loadPairs(r, out->last_release_)) return nullptr;
+        return out;
+    }
+};
+
+#endif //CMSSOHHWINDOW_H
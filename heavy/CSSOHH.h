@@ -4,9 +4,13 @@
 
 #include <vector>
 #include <utility>
+#include <memory>
+#include <optional>
 #include "sketchHH.h"
-#include "../heap/IndexMinHeap.h"
+#include "../heap/CandidateStore.h"
 #include "../sketch/CSSO.h"
+#include "ElasticFront.h"
+#include "PacketSampler.h"
 
 using namespace std;
 
@@ -20,11 +24,49 @@ private:
     double eps_{1.0};
     double delta_{1e-6};
     CSSO* sketch;
-    IndexMinHeap<int,double> heap;
+    CandidateStore heap;
+    ElasticFront* front_{nullptr};
+    PacketSampler sampler_;
+
+    // With a front end: the sketch with the front counts flushed in, rebuilt
+    // by released() on the first read after an update. Like the rest of the
+    // engine, not safe to read from several threads at once.
+    mutable optional<CSSO> released_;
+    mutable bool released_stale_{true};
+
+    // Used by load(); the sketch and heap come from the snapshot.
+    CSSOHH() : sketch(nullptr), heap(0, CandidatePolicy::Auto, false) {}
+
+    template<typename Estimate>
+    void ingest(int item, Estimate&& estimate) {
+        ++n_;
+        if (sampler_.sampling() && !sampler_.admit()) return;
+
+        double est;
+        if (front_) {
+            released_stale_ = true;
+            ElasticFront::Eviction ev;
+            bool admitted;
+            ElasticFront::Slot* slot = front_->insert(item, ev, admitted);
+            if (ev.happened) sketch->update(ev.key, static_cast<int>(ev.count));
+            if (slot) {
+                if (admitted) slot->base = ElasticFront::toBase(sketch->rank_query(item));
+                est = static_cast<double>(slot->base) + slot->count;
+            } else {
+                est = estimate();
+            }
+        } else {
+            est = estimate();
+        }
+
+        heap.offer(item, est);
+    }
 
 public:
-    CSSOHH(int depth, double epsilon, double delta, int k, int tilde_k, uint32_t seed_index, uint32_t seed_sign, size_t T)
-        : k_(k), tilde_k_(tilde_k),  eps_(epsilon), delta_(delta), heap(tilde_k) {
+    CSSOHH(int depth, double epsilon, double delta, int k, int tilde_k, uint32_t seed_index, uint32_t seed_sign, size_t T,
+           size_t front_buckets = 0, double sample_rate = 1.0,
+           CandidatePolicy candidates = CandidatePolicy::Auto, int counter_bits = 0)
+        : k_(k), tilde_k_(tilde_k),  eps_(epsilon), delta_(delta), heap(tilde_k, candidates, false), sampler_(sample_rate) {
         int min_d;
         min_d = static_cast<int>(log(4.0*static_cast<double>(T)/(delta_))) +1;
 
@@ -33,56 +75,166 @@ public:
         } else {
             depth_ = depth;
         }
-        sketch = new CSSO(3*tilde_k, depth_, epsilon, seed_index, seed_sign);
+        sketch = new CSSO(3*tilde_k, depth_, sampler_.sketchEps(epsilon), seed_index, seed_sign, counter_bits);
+        if (front_buckets) front_ = new ElasticFront(front_buckets);
     }
 
     ~CSSOHH() override {
         delete sketch;
+        delete front_;
     }
 
     void update(int item) override {
-        ++n_;
-        // sketch->update(item, 1);
-        double est = sketch->update_estimate(item, 1);
-
-        if (heap.contains(item)) {
-            heap.update(item, est);
-        } else if (!heap.full()) {
-            heap.insert(item, est);
-        } else if (est > heap.min_value()) {
-            heap.replace_top(item, est);
+        ingest(item, [&] { return sketch->update_estimate(item, 1); });
+    }
+
+    // update() with the index and sign row hashes of item precomputed, see
+    // CSSO::update_estimate_hashed().
+    void update_hashed(int item, const uint32_t* hi, const uint32_t* hs) {
+        ingest(item, [&] { return sketch->update_estimate_hashed(hi, hs, 1); });
+    }
+
+    [[nodiscard]] uint32_t index_seed() const { return sketch->index_seed(); }
+    [[nodiscard]] uint32_t sign_seed() const { return sketch->sign_seed(); }
+    [[nodiscard]] int rows() const { return sketch->rows(); }
+
+    // Sign seeds follow CSSO::reset(seed). Loaded engines reset too: the
+    // sketch gets its epsilon from here.
+    void reset(uint32_t seed) override {
+        n_ = 0;
+        sketch->reset(seed, seed + depth_, sampler_.sketchEps(eps_));
+        heap.clear();
+        if (front_) front_->clear();
+        sampler_.reset();
+        released_stale_ = true;
+    }
+
+    // The table the plain engine would hold, which query() and estimate()
+    // read: the noisy sketch itself or, with a front end, a cached copy with
+    // every count still held by the front end flushed back in. Refreshing the
+    // cache copies into the buffers it already holds.
+    [[nodiscard]] const CSSO& released() const {
+        if (!front_) return *sketch;
+        if (released_stale_) {
+            released_ = *sketch;
+            front_->for_each([&](int key, uint32_t count) {
+                released_->update(key, static_cast<int>(count));
+            });
+            released_stale_ = false;
         }
+        return *released_;
     }
 
+    // An owned copy of released().
+    [[nodiscard]] CSSO releasedSketch() const { return released(); }
+
+    [[nodiscard]] const ElasticFront* front() const { return front_; }
+
     vector<pair<int, double>> query() const override {
         vector<pair<int,double>> filter;
 
+        const CSSO& released = this->released();
+
+        // Sampled counts are rescaled by 1/p; the noise, drawn at the
+        // amplified budget, and the F2-based error are rescaled with them.
+        const double scale = 1.0 / sampler_.rate();
+
         double noise;
-        noise = (2.0 * depth_ / eps_) * log(6.0 * depth_ * static_cast<double>(tilde_k_) / delta_);
+        noise = (2.0 * depth_ / sampler_.sketchEps(eps_)) * log(6.0 * depth_ * static_cast<double>(tilde_k_) / delta_);
+        noise *= scale;
 
         const double eta = sqrt(3.0 / static_cast<double>(tilde_k_));
-        double F2_est = sketch->queryF2();
+        double F2_est = released.queryF2();
         double F2_upper = (1+eta) * F2_est;
 
-        double freq_error = eta * sqrt(F2_upper / static_cast<double>(tilde_k_));
+        double freq_error = eta * sqrt(F2_upper / static_cast<double>(tilde_k_)) * scale;
 
         double additive_error = 3 * (noise + freq_error);
 
         const auto n_double = static_cast<double>(n_);
         const double tau_1 = n_double / static_cast<double>(k_);
-        const double tau_2 = n_double / static_cast<double>(tilde_k_) + 1.0 + additive_error;
+        const double tau_2 = n_double / static_cast<double>(tilde_k_) + 1.0 + additive_error
+                           + sampler_.samplingError(tau_1, delta_, static_cast<double>(tilde_k_));
         const double tau = max(tau_1, tau_2);
 
         // printf("noise: %.2f, tau_1: %.2f, tau_2 %.2f\n", noise, tau_1, tau_2);
 
         for (auto &p : heap.items()) {
-            double est = sketch->query(p.first);
-            if (p.second >= tau && est >= tau) {
-                filter.push_back(p);
+            double est = released.query(p.first) * scale;
+            // With a front end or compact counters the heap scores are
+            // (partly) exact counts, so only the released estimate decides
+            // and is reported.
+            if (front_ || sketch->compact()) {
+                if (est >= tau) filter.emplace_back(p.first, est);
+            } else if (p.second * scale >= tau && est >= tau) {
+                filter.emplace_back(p.first, p.second * scale);
             }
         }
         return filter;
     }
+
+    // The released sketch's estimate of any key, tracked or not, rescaled
+    // like query(). This is post-processing of the noisy table, so a lookup
+    // spends no budget beyond the table's own and needs no threshold. With a
+    // front end it reads released(), which only copies after an update.
+    [[nodiscard]] double estimate(int item) const override {
+        double out;
+        estimateBatch({&item, 1}, {&out, 1});
+        return out;
+    }
+
+    [[nodiscard]] size_t tracked_keys() const override {
+        return heap.capacity();
+    }
+
+    MemoryBreakdown memory_breakdown() const override {
+        MemoryBreakdown m;
+        m.add("object", sizeof(*this));
+        m.add("sketch", sketch->memory_breakdown());
+        m.add("heap", heap.memory_breakdown());
+        if (front_) m.add("front", front_->memory_breakdown());
+        return m;
+    }
+
+    // The noisy sketch is stored as is, so a reload draws no new noise and
+    // the privacy accounting of the original run carries over. Counts held
+    // by a front end are flushed into the stored sketch; the reloaded engine
+    // runs without one.
+    void save(SnapshotWriter& w) const {
+        const size_t at = w.beginSection(SnapshotKind::CSSOHH);
+        w.put<uint64_t>(k_);
+        w.put<uint64_t>(tilde_k_);
+        w.put<uint64_t>(n_);
+        w.put<int32_t>(depth_);
+        w.put<double>(eps_);
+        w.put<double>(delta_);
+        w.put<double>(sampler_.rate());
+        released().save(w);
+        heap.save(w);
+        w.endSection(at);
+    }
+
+    static unique_ptr<CSSOHH> load(SnapshotReader& r) {
+        if (!r.section(SnapshotKind::CSSOHH)) return nullptr;
+        unique_ptr<CSSOHH> out(new CSSOHH());
+        out->k_ = r.get<uint64_t>();
+        out->tilde_k_ = r.get<uint64_t>();
+        out->n_ = r.get<uint64_t>();
+        out->depth_ = r.get<int32_t>();
+        out->eps_ = r.get<double>();
+        out->delta_ = r.get<double>();
+        out->sampler_ = PacketSampler(r.get<double>());
+        out->sketch = CSSO::load(r).release();
+        if (!out->sketch || !out->heap.load(r)) return nullptr;
+        return out;
+    }
+
+protected:
+    void estimateBatch(span<const int> items, span<double> out) const override {
+        released().query_batch(items.data(), items.size(), out.data());
+        const double scale = 1.0 / sampler_.rate();
+        for (double& v : out) v *= scale;
+    }
 };
 
 
@@ -0,0 +1,318 @@
+
+#ifndef CONTINUALCMSSOHH_H
+#define CONTINUALCMSSOHH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+#include <utility>
+
+#include "SketchHH.h"
+#include "../heap/IndexMinHeap.h"
+#include "../sketch/Sketch.h"
+
+using namespace std;
+
+// Count-Min heavy hitters with continual release every `release_every` items,
+// up to a horizon of T items. The tree is sized for T: update() throws
+// length_error on item T + 1 rather than release with missing noise.
+//
+// Privacy uses the binary (tree) mechanism over release intervals. The table
+// is kept exact. Every dyadic block of intervals gets its own Laplace noise
+// per cell, and the noisy table at release r is the exact table plus the
+// noise of the O(log R) blocks that make up [0, r). An item touches one
+// block per level in each of `depth` rows, so each block is drawn at scale
+// 2 * depth * levels / eps. Noise is derived on demand from a private seed,
+// so blocks that are never read are never materialised.
+//
+// Candidates are kept in a heap on exact estimates, as in CMSSOHH, and the
+// candidate set is treated as public the same way. At each release every
+// candidate whose exact estimate has reached the cutoff, the threshold less
+// noiseBound(), joins the "hot" set, whether or not the key itself arrived
+// since the last release: Count-Min collisions can lift it too. The release
+// computes the noisy estimate of every hot key, reports those at or above
+// the threshold, and drops from the hot set those whose noisy estimate the
+// next threshold has left behind, so the costly tree-noise reads follow the
+// number of plausible heavy hitters rather than tilde_k.
+//
+// Hot-set membership is decided on exact estimates. Outside the event that
+// some noise exceeds noiseBound(), which has probability at most delta, a
+// key with noisy estimate >= tau has exact estimate >= the cutoff and is hot,
+// so the release equals the one that scores every candidate on its noisy
+// estimate, a post-processing of the tree mechanism. The engine is therefore
+// (eps, delta)-DP given the candidate set, not eps-DP.
+//
+// query() returns the most recent release and draws no new noise.
+//
+// Count-Min only. A continual Count-Sketch engine (CSSOHH) is out of scope:
+// its estimates are medians of signed counters and not monotone, so the
+// hot-set admission above does not carry over.
+class ContinualCMSSOHH : public SketchHH {
+private:
+
+    size_t k_{0};
+    size_t tilde_k_{0};
+    size_t n_{0};
+    int depth_{0};
+    int width_{0};
+    int levels_{1};
+    uint32_t seed_{0};
+    uint64_t noise_seed_{0};
+    double eps_{1.0};
+    double delta_{1e-6};
+    size_t horizon_{0};
+    size_t release_every_{1};
+    size_t releases_{0};
+
+    vector<uint32_t> table_;        // exact counts, depth_ * width_
+    IndexMinHeap<int,double> heap;  // candidates on exact estimates
+    size_t hot_bytes_{0};
+    unordered_set<int, hash<int>, equal_to<int>, CountingAllocator<int>> hot_;
+    double cutoff_{0.0};            // hot-set admission for the next release
+    vector<pair<int, double>> released_;
+
+    [[nodiscard]] size_t cell(int row, int item) const {
+        return static_cast<size_t>(row) * width_ + Sketch::hash(item, seed_ + row) % width_;
+    }
+
+    [[nodiscard]] double exactEstimate(int item) const {
+        uint32_t est = numeric_limits<uint32_t>::max();
+        for (int i = 0; i < depth_; ++i) est = min(est, table_[cell(i, item)]);
+        return est;
+    }
+
+    [[nodiscard]] double nodeScale() const {
+        return 2.0 * depth_ * levels_ / eps_;
+    }
+
+    // High-probability bound on the sum of up to levels_ Laplace draws
+    // (Chan, Shi and Song's tail bound), union-bounded over rows and
+    // candidates as in CMSSOHH.
+    [[nodiscard]] double noiseBound() const {
+        const double log_term = log(2.0 * 4.0 * depth_ * static_cast<double>(tilde_k_) / delta_);
+        const double nu = nodeScale() * max(sqrt(static_cast<double>(levels_)), sqrt(log_term));
+        return nu * sqrt(8.0 * log_term);
+    }
+
+    [[nodiscard]] double threshold(size_t n) const {
+        const auto n_double = static_cast<double>(n);
+        const double tau_1 = n_double / static_cast<double>(k_);
+        const double tau_2 = 3*n_double / static_cast<double>(tilde_k_) + 1.0 + 3*noiseBound();
+        return max(tau_1, tau_2);
+    }
+
+    // Laplace noise of dyadic block (level, index) for one cell.
+    [[nodiscard]] double blockNoise(size_t c, int level, size_t index) const {
+        uint64_t z = noise_seed_
+                   ^ (static_cast<uint64_t>(c) * 0x9e3779b97f4a7c15ull)
+                   ^ (static_cast<uint64_t>(level) << 56)
+                   ^ (static_cast<uint64_t>(index) * 0xc2b2ae3d27d4eb4full);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        z ^= z >> 31;
+        const double u = (static_cast<double>(z >> 11) + 0.5) * (1.0 / 9007199254740992.0) - 0.5;
+        const double mag = -nodeScale() * log(1.0 - 2.0 * fabs(u));
+        return u < 0 ? -mag : mag;
+    }
+
+    // Estimate as released at release r: exact table plus tree noise of [0, r).
+    [[nodiscard]] double noisyEstimate(int item, size_t r) const {
+        double est = numeric_limits<double>::max();
+        for (int i = 0; i < depth_; ++i) {
+            const size_t c = cell(i, item);
+            double v = table_[c];
+            for (int j = 0; j < levels_; ++j) {
+                if (r & (size_t{1} << j)) v += blockNoise(c, j, r >> (j + 1));
+            }
+            est = min(est, v);
+        }
+        return est;
+    }
+
+    void release() {
+        ++releases_;
+        const double tau = threshold(n_);
+
+        for (const auto& p : heap.items()) {
+            if (exactEstimate(p.first) >= cutoff_) hot_.insert(p.first);
+        }
+
+        // This release's noise and the next one's are each within
+        // noiseBound(), so a key stays hot while its noisy estimate is within
+        // two bounds of the next threshold.
+        cutoff_ = threshold(n_ + release_every_) - noiseBound();
+        const double keep = cutoff_ - noiseBound();
+
+        released_.clear();
+        for (auto it = hot_.begin(); it != hot_.end();) {
+            const double noisy = noisyEstimate(*it, releases_);
+            if (noisy >= tau) released_.emplace_back(*it, noisy);
+            if (noisy < keep) it = hot_.erase(it);
+            else ++it;
+        }
+    }
+
+    // Used by load(); every field comes from the snapshot.
+    ContinualCMSSOHH()
+        : heap(0), hot_(0, hash<int>(), equal_to<int>(), CountingAllocator<int>(&hot_bytes_)) {}
+
+public:
+    ContinualCMSSOHH(int depth, double epsilon, double delta, int k, int tilde_k, uint32_t seed,
+                     size_t T, size_t release_every)
+        : k_(k), tilde_k_(tilde_k), seed_(seed), eps_(epsilon), delta_(delta),
+          horizon_(T), release_every_(release_every ? release_every : 1), heap(tilde_k),
+          hot_(0, hash<int>(), equal_to<int>(), CountingAllocator<int>(&hot_bytes_)) {
+        int min_d;
+        min_d = static_cast<int>(log(4.0*(static_cast<double>(T)+tilde_k)/(delta_))) +1;
+
+        if(depth < min_d) {
+            depth_ = min_d;
+        } else {
+            depth_ = depth;
+        }
+        width_ = 2 * tilde_k;
+
+        const size_t max_releases = T / release_every_ + 1;
+        while ((size_t{1} << levels_) <= max_releases) ++levels_;
+
+        table_.assign(static_cast<size_t>(depth_) * width_, 0);
+        reset(seed);
+    }
+
+    void reset(uint32_t seed) override {
+        seed_ = seed;
+        n_ = 0;
+        releases_ = 0;
+        fill(table_.begin(), table_.end(), 0);
+        heap.clear();
+        hot_.clear();
+        released_.clear();
+
+        random_device rd;
+        noise_seed_ = (static_cast<uint64_t>(rd()) << 32) | rd();
+        cutoff_ = threshold(release_every_) - noiseBound();
+    }
+
+    void update(int item) override {
+        if (n_ == horizon_) throw length_error("ContinualCMSSOHH::update: stream longer than horizon T");
+        ++n_;
+
+        uint32_t est = numeric_limits<uint32_t>::max();
+        for (int i = 0; i < depth_; ++i) {
+            uint32_t& c = table_[cell(i, item)];
+            ++c;
+            est = min(est, c);
+        }
+
+        const auto est_double = static_cast<double>(est);
+        if (heap.contains(item)) {
+            heap.update(item, est_double);
+        } else if (!heap.full()) {
+            heap.insert(item, est_double);
+        } else if (est_double > heap.min_value()) {
+            hot_.erase(heap.top().first);
+            heap.replace_top(item, est_double);
+        }
+
+        if (n_ % release_every_ == 0) release();
+    }
+
+    // Result of the most recent release.
+    vector<pair<int, double>> query() const override {
+        return released_;
+    }
+
+    // The count the most recent release reported for item, 0 if it was not
+    // reported. Like query() this draws no new noise and spends no budget;
+    // it scans the release, which holds the heavy hitters only.
+    [[nodiscard]] double estimate(int item) const override {
+        for (const auto& p : released_) {
+            if (p.first == item) return p.second;
+        }
+        return 0.0;
+    }
+
+    [[nodiscard]] size_t releases() const { return releases_; }
+    [[nodiscard]] size_t hot_keys() const { return hot_.size(); }
+
+    [[nodiscard]] size_t tracked_keys() const override {
+        return heap.capacity();
+    }
+
+    MemoryBreakdown memory_breakdown() const override {
+        MemoryBreakdown m;
+        m.add("object", sizeof(*this));
+        m.add("table", vectorBytes(table_));
+        m.add("heap", heap.memory_breakdown());
+        m.add("hot", hot_bytes_);
+        m.add("released", vectorBytes(released_));
+        return m;
+    }
+
+    // Stores the exact table and the tree's noise seed, so later releases of
+    // a reloaded engine reuse the blocks already released instead of drawing
+    // new ones. A snapshot is therefore as sensitive as the stream itself and
+    // must not be published.
+    void save(SnapshotWriter& w) const {
+        const size_t at = w.beginSection(SnapshotKind::ContinualCMSSOHH);
+        w.put<uint64_t>(k_);
+        w.put<uint64_t>(tilde_k_);
+        w.put<uint64_t>(n_);
+        w.put<int32_t>(depth_);
+        w.put<int32_t>(width_);
+        w.put<int32_t>(levels_);
+        w.put<uint32_t>(seed_);
+        w.put<uint64_t>(noise_seed_);
+        w.put<double>(eps_);
+        w.put<double>(delta_);
+        w.put<uint64_t>(horizon_);
+        w.put<uint64_t>(release_every_);
+        w.put<uint64_t>(releases_);
+        w.put<double>(cutoff_);
+        w.putArray(table_.data(), table_.size());
+        heap.save(w);
+        vector<int> hot(hot_.begin(), hot_.end());
+        sort(hot.begin(), hot.end());
+        w.put<uint64_t>(hot.size());
+        w.putArray(hot.data(), hot.size());
+        savePairs(w, released_);
+        w.endSection(at);
+    }
+
+    static unique_ptr<ContinualCMSSOHH> load(SnapshotReader& r) {
+        if (!r.section(SnapshotKind::ContinualCMSSOHH)) return nullptr;
+        unique_ptr<ContinualCMSSOHH> out(new ContinualCMSSOHH());
+        out->k_ = r.get<uint64_t>();
+        out->tilde_k_ = r.get<uint64_t>();
+        out->n_ = r.get<uint64_t>();
+        out->depth_ = r.get<int32_t>();
+        out->width_ = r.get<int32_t>();
+        out->levels_ = r.get<int32_t>();
+        out->seed_ = r.get<uint32_t>();
+        out->noise_seed_ = r.get<uint64_t>();
+        out->eps_ = r.get<double>();
+        out->delta_ = r.get<double>();
+        out->horizon_ = r.get<uint64_t>();
+        out->release_every_ = r.get<uint64_t>();
+        out->releases_ = r.get<uint64_t>();
+        out->cutoff_ = r.get<double>();
+        if (!r.ok() || out->depth_ <= 0 || out->width_ <= 0 || out->release_every_ == 0) return nullptr;
+
+        out->table_.resize(static_cast<size_t>(out->depth_) * out->width_);
+        if (!r.getArray(out->table_.data(), out->table_.size()) || !out->heap.load(r)) return nullptr;
+        const auto n_hot = r.get<uint64_t>();
+        if (!r.ok()) return nullptr;
+        vector<int> hot(n_hot);
+        if (!r.getArray(hot.data(), n_hot)) return nullptr;
+        out->hot_.insert(hot.begin(), hot.end());
+        if (!loadPairs(r, out->released_)) return nullptr;
+        return out;
+    }
+};
+
+#endif //CONTINUALCMSSOHH_H
@@ -0,0 +1,152 @@
+
+#ifndef ELASTICFRONT_H
+#define ELASTICFRONT_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "../help/CountingAllocator.h"
+
+using namespace std;
+
+// Heavy part of an Elastic-style heavy/light split, placed in front of the
+// deep DP sketch of CMSSOHH and CSSOHH.
+//
+// A small array of buckets, SLOTS keys each, holds exact counts for the keys
+// that currently dominate their bucket. An item whose key is held costs one
+// cache line and no sketch rows. Any other item either takes a free slot or
+// votes against the bucket's smallest entry: once the negative votes reach
+// LAMBDA times that entry's count, the entry is evicted and its count is
+// flushed into the sketch, and the new key takes the slot. Items that neither
+// match nor evict go to the sketch as before.
+//
+// Counts are only ever moved between the front end and the sketch, never
+// dropped. The owners release the sketch with every held count flushed
+// back in, which gives exactly the table the plain engine would hold, so
+// sensitivity and noise are unchanged.
+class ElasticFront {
+public:
+    static constexpr int SLOTS = 4;
+    static constexpr uint32_t LAMBDA = 8;
+
+    struct Slot {
+        int key;
+        uint32_t count;  // exact count since admission
+        int32_t base;    // sketch estimate of the key at admission, see toBase()
+    };
+
+    // Admission estimates are kept rounded to whole counts: a float loses
+    // integer precision above 2^24 items and a double would push a bucket
+    // past one cache line.
+    static int32_t toBase(double estimate) {
+        return static_cast<int32_t>(llround(clamp(estimate, static_cast<double>(INT32_MIN),
+                                                  static_cast<double>(INT32_MAX))));
+    }
+
+    struct Eviction {
+        bool happened{false};
+        int key{0};
+        uint32_t count{0};
+    };
+
+    explicit ElasticFront(size_t buckets) {
+        size_t n = 1;
+        while (n < buckets) n <<= 1;
+        shift_ = 32;
+        for (size_t m = n; m > 1; m >>= 1) --shift_;
+        buckets_.resize(n);
+    }
+
+    // Returns the slot now holding item, or nullptr if the item goes to the
+    // sketch. admitted is set when the item took a slot on this call; the
+    // caller then fills in its base. On eviction, ev holds the count to flush.
+    Slot* insert(int item, Eviction& ev, bool& admitted) {
+        Bucket& b = buckets_[index(item)];
+        admitted = false;
+
+        int smallest = 0;
+        for (int i = 0; i < SLOTS; ++i) {
+            if (b.used & (1u << i)) {
+                if (b.slots[i].key == item) {
+                    ++b.slots[i].count;
+                    ++hits_;
+                    return &b.slots[i];
+                }
+                if (b.slots[i].count < b.slots[smallest].count || !(b.used & (1u << smallest))) {
+                    smallest = i;
+                }
+            }
+        }
+
+        for (int i = 0; i < SLOTS; ++i) {
+            if (!(b.used & (1u << i))) {
+                b.used |= 1u << i;
+                b.slots[i] = {item, 1, 0};
+                admitted = true;
+                return &b.slots[i];
+            }
+        }
+
+        ++b.vote_neg;
+        if (b.vote_neg < LAMBDA * b.slots[smallest].count) {
+            ++misses_;
+            return nullptr;
+        }
+
+        ev = {true, b.slots[smallest].key, b.slots[smallest].count};
+        b.slots[smallest] = {item, 1, 0};
+        b.vote_neg = 0;
+        ++evictions_;
+        admitted = true;
+        return &b.slots[smallest];
+    }
+
+    // Calls f(key, count) for every held key.
+    template<typename F>
+    void for_each(F&& f) const {
+        for (const Bucket& b : buckets_) {
+            for (int i = 0; i < SLOTS; ++i) {
+                if (b.used & (1u << i)) f(b.slots[i].key, b.slots[i].count);
+            }
+        }
+    }
+
+    // Drops every held key without flushing it, and the counters.
+    void clear() {
+        fill(buckets_.begin(), buckets_.end(), Bucket{});
+        hits_ = misses_ = evictions_ = 0;
+    }
+
+    [[nodiscard]] uint64_t hits() const { return hits_; }
+    [[nodiscard]] uint64_t misses() const { return misses_; }
+    [[nodiscard]] uint64_t evictions() const { return evictions_; }
+
+    MemoryBreakdown memory_breakdown() const {
+        MemoryBreakdown m;
+        m.add("buckets", vectorBytes(buckets_));
+        return m;
+    }
+
+private:
+    // Four 12-byte slots and the two bucket words fit one cache line.
+    struct alignas(64) Bucket {
+        Slot slots[SLOTS];
+        uint32_t vote_neg{0};
+        uint32_t used{0};
+    };
+
+    vector<Bucket> buckets_;
+    int shift_{32};
+    uint64_t hits_{0};
+    uint64_t misses_{0};
+    uint64_t evictions_{0};
+
+    [[nodiscard]] size_t index(int item) const {
+        if (shift_ >= 32) return 0;
+        return (static_cast<uint32_t>(item) * 0x9e3779b1u) >> shift_;
+    }
+};
+
+#endif //ELASTICFRONT_H
@@ -0,0 +1,214 @@
+
+#ifndef HHHSSSO_H
+#define HHHSSSO_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "SketchHH.h"
+#include "SpaceSaving.h"
+
+struct HHHPrefix {
+    uint32_t prefix;     // masked address
+    int length;          // prefix length in bits
+    double count;        // noisy count of every item under the prefix
+    double conditioned;  // count minus the reported descendants it covers
+};
+
+// Single-pass hierarchical heavy hitters over IPv4 prefixes.
+//
+// One SpaceSaving summary per prefix length (default /8, /16, /24, /32). An
+// update masks the address once per level and feeds every summary in the
+// same pass. Each item reaches every level, so the privacy budget is split
+// evenly: every level releases its summary as SSSO does, with eps/L and
+// delta/L.
+//
+// query_hierarchical() walks from the longest prefix to the shortest. A
+// prefix is reported when its conditioned count clears that level's
+// threshold. The conditioned count is its noisy count minus the noisy counts
+// of reported descendants not already covered by a reported prefix in
+// between (the discounted HHH definition). query() returns the part of that
+// answer at the longest prefix length (/32 by default), so the engine can be
+// scored like the flat engines.
+class HHHSSSO : public SketchHH {
+
+private:
+    size_t k_{0};
+    size_t tilde_k_{0};
+    size_t n_{0};
+    double eps_{1.0};
+    double delta_{1e-6};
+
+    vector<int> lengths_;
+    vector<uint32_t> masks_;
+    vector<SpaceSaving*> levels_;
+
+    static uint32_t maskFor(int length) {
+        return length == 0 ? 0u : ~0u << (32 - length);
+    }
+
+    // SSSO threshold of one level, at eps/L and delta/L.
+    [[nodiscard]] double levelThreshold() const {
+        const auto L = static_cast<double>(levels_.size());
+        const double gamma = (L / eps_) * log(2.0 * L / delta_);
+        const auto n_double = static_cast<double>(n_);
+        return max(n_double / static_cast<double>(k_),
+                   n_double / static_cast<double>(tilde_k_) + 1.0 + gamma);
+    }
+
+public:
+
+    HHHSSSO(size_t k, size_t tilde_k, double eps, double delta,
+            vector<int> lengths = {8, 16, 24, 32})
+        : k_(k),
+          tilde_k_(tilde_k),
+          eps_(eps),
+          delta_(delta),
+          lengths_(std::move(lengths)) {
+        sort(lengths_.begin(), lengths_.end());
+        for (int len : lengths_) {
+            masks_.push_back(maskFor(len));
+            levels_.push_back(new SpaceSaving(tilde_k));
+        }
+    }
+
+    ~HHHSSSO() override {
+        for (auto& ss : levels_) delete ss;
+    }
+
+    void reset(uint32_t seed) override {
+        for (auto& ss : levels_) ss->reset(seed);
+        n_ = 0;
+        last_release_.clear();
+    }
+
+    void update(int item) override {
+        const auto addr = static_cast<uint32_t>(item);
+        for (size_t l = 0; l < levels_.size(); ++l) {
+            levels_[l]->update(static_cast<int>(addr & masks_[l]));
+        }
+        ++n_;
+    }
+
+    [[nodiscard]] vector<HHHPrefix> query_hierarchical() const {
+        vector<HHHPrefix> out;
+        if (k_ == 0 || eps_ <= 0.0 || delta_ <= 0.0 || levels_.empty()) {
+            return out;
+        }
+
+        const double eps_level = eps_ / static_cast<double>(levels_.size());
+        const double tau = levelThreshold();
+
+        vector<bool> covered;
+        for (size_t l = levels_.size(); l-- > 0;) {
+            const size_t first_finer = out.size();
+            for (const auto& kv : levels_[l]->query()) {
+                const auto prefix = static_cast<uint32_t>(kv.first);
+                const double noisy = kv.second + laplaceNoise(eps_level, /*sensitivity=*/1.0);
+
+                double conditioned = noisy;
+                for (size_t h = 0; h < first_finer; ++h) {
+                    if (!covered[h] && (out[h].prefix & masks_[l]) == prefix) {
+                        conditioned -= out[h].count;
+                    }
+                }
+                if (conditioned > tau) {
+                    out.push_back({prefix, lengths_[l], noisy, conditioned});
+                    covered.push_back(false);
+                }
+            }
+            // Descendants of prefixes reported at this level are now covered.
+            for (size_t h = 0; h < first_finer; ++h) {
+                if (covered[h]) continue;
+                for (size_t p = first_finer; p < out.size(); ++p) {
+                    if ((out[h].prefix & masks_[l]) == out[p].prefix) {
+                        covered[h] = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        vector<pair<int, double>> longest;
+        for (const HHHPrefix& p : out) {
+            if (p.length == lengths_.back()) longest.emplace_back(static_cast<int>(p.prefix), p.count);
+        }
+        recordRelease(std::move(longest));
+        return out;
+    }
+
+    [[nodiscard]] vector<pair<int, double>> query() const override {
+        vector<pair<int, double>> out;
+        for (const HHHPrefix& p : query_hierarchical()) {
+            if (p.length == lengths_.back()) out.emplace_back(static_cast<int>(p.prefix), p.count);
+        }
+        return out;
+    }
+
+    // The noisy, unconditioned count the last query() or
+    // query_hierarchical() reported for item's prefix at the longest level,
+    // else 0; see SketchHH.
+    [[nodiscard]] double estimate(int item) const override {
+        if (levels_.empty()) return 0.0;
+        return releasedCount(static_cast<int>(static_cast<uint32_t>(item) & masks_.back()));
+    }
+
+    [[nodiscard]] size_t tracked_keys() const override {
+        return levels_.size() * tilde_k_;
+    }
+
+    MemoryBreakdown memory_breakdown() const override {
+        MemoryBreakdown m;
+        m.add("object", sizeof(*this));
+        m.add("levels", vectorBytes(lengths_) + vectorBytes(masks_) + vectorBytes(levels_));
+        for (size_t l = 0; l < levels_.size(); ++l) {
+            m.add("prefix" + to_string(lengths_[l]), levels_[l]->memory_breakdown());
+        }
+        return m;
+    }
+
+    // Only the exact per-level summaries are stored; noise is drawn at query.
+    void save(SnapshotWriter& w) const {
+        const size_t at = w.beginSection(SnapshotKind::HHHSSSO);
+        w.put<uint64_t>(k_);
+        w.put<uint64_t>(tilde_k_);
+        w.put<uint64_t>(n_);
+        w.put<double>(eps_);
+        w.put<double>(delta_);
+        w.put<uint64_t>(lengths_.size());
+        w.putArray(lengths_.data(), lengths_.size());
+        for (const SpaceSaving* ss : levels_) ss->save(w);
+        w.endSection(at);
+    }
+
+    static unique_ptr<HHHSSSO> load(SnapshotReader& r) {
+        if (!r.section(SnapshotKind::HHHSSSO)) return nullptr;
+        const auto k = r.get<uint64_t>();
+        const auto tilde_k = r.get<uint64_t>();
+        const auto n = r.get<uint64_t>();
+        const auto eps = r.get<double>();
+        const auto delta = r.get<double>();
+        const auto L = r.get<uint64_t>();
+        if (!r.ok()) return nullptr;
+        vector<int> lengths(L);
+        if (!r.getArray(lengths.data(), L)) return nullptr;
+        for (int len : lengths) {
+            if (len < 0 || len > 32) return nullptr;
+        }
+
+        unique_ptr<HHHSSSO> out(new HHHSSSO(k, 0, eps, delta, lengths));
+        for (size_t l = 0; l < L; ++l) {
+            unique_ptr<SpaceSaving> ss = SpaceSaving::load(r);
+            if (!ss) return nullptr;
+            delete out->levels_[l];
+            out->levels_[l] = ss.release();
+        }
+        out->tilde_k_ = tilde_k;
+        out->n_ = n;
+        return out;
+    }
+};
+
+#endif //HHHSSSO_H
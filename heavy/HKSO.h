@@ -0,0 +1,237 @@
+
+#ifndef HKSO_H
+#define HKSO_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <utility>
+
+#include "SketchHH.h"
+#include "../heap/IndexMinHeap.h"
+#include "../sketch/Sketch.h"
+
+using namespace std;
+
+// HeavyKeeper (count-with-exponential-decay) heavy hitters with a noisy
+// release.
+//
+// `depth` rows of `width` buckets hold a 32-bit fingerprint and a count. An
+// item whose fingerprint owns its bucket increments it; an empty bucket is
+// taken over; otherwise the owner's count decays by one with probability
+// DECAY^-count and the item takes the bucket once it reaches zero. Elephant
+// flows keep their buckets, so two rows suffice where the Count-Min engines
+// need depth >= 25. Candidates sit in an IndexMinHeap as in CMSSOHH.
+//
+// Release, in the style of SSSO: each candidate estimate gets fresh Laplace
+// noise at query time and is reported if it clears tau. HeavyKeeper only
+// under-estimates (up to fingerprint collisions), so tau needs no term for
+// over-counting: tau = max(n/k, 1 + gamma).
+//
+// This is NOT a differential privacy guarantee, and HKSO is not registered
+// with the DP engines in the experiment sweeps. The decay coin is a keyed
+// hash of (row, bucket, count, fingerprint) rather than a shared random
+// stream, so changing one item only changes the history of the 2 * depth
+// buckets the old and new item hash to; every other bucket evolves
+// identically. Inside those buckets there is no constant bound: one item can
+// decide which of two keys owns a bucket, and the two histories then differ
+// by the owner's whole count. The noise scale depth + 1 covers only the
+// direct effect of one update (its own key up by one, one decay per row).
+class HKSO : public SketchHH {
+private:
+    static constexpr double DECAY = 1.08;
+    static constexpr uint32_t DECAY_TABLE = 512;  // beyond this, decay odds are ~0
+
+    struct Bucket {
+        uint32_t fp{0};
+        uint32_t count{0};
+    };
+
+    size_t k_{0};
+    size_t tilde_k_{0};
+    size_t n_{0};
+    int depth_{0};
+    int width_{0};
+    uint32_t seed_{0};
+    double eps_{1.0};
+    double delta_{1e-6};
+
+    vector<Bucket> buckets_;            // depth_ * width_
+    vector<uint32_t> decay_threshold_;  // 2^32 * DECAY^-count
+    uint64_t decay_key_{0};
+    IndexMinHeap<int,double> heap;
+
+    // Decay coin for the bucket at `cell` holding (fp, count), keyed by a
+    // secret so it is unpredictable but depends on nothing outside the bucket.
+    [[nodiscard]] uint32_t decayCoin(size_t cell, uint32_t fp, uint32_t count) const {
+        uint64_t z = decay_key_ ^ ((static_cast<uint64_t>(fp) << 32) | count);
+        z += (static_cast<uint64_t>(cell) + 1) * 0x9e3779b97f4a7c15ull;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return static_cast<uint32_t>((z ^ (z >> 31)) >> 32);
+    }
+
+    [[nodiscard]] double threshold() const {
+        const double gamma = ((depth_ + 1.0) / eps_) * log(2.0 * static_cast<double>(tilde_k_) / delta_);
+        return max(static_cast<double>(n_) / static_cast<double>(k_), 1.0 + gamma);
+    }
+
+    void seedDecay() {
+        random_device rd;
+        decay_key_ = (static_cast<uint64_t>(rd()) << 32) | rd();
+    }
+
+public:
+    HKSO(size_t k, size_t tilde_k, double eps, double delta, int width, int depth, uint32_t seed)
+        : k_(k), tilde_k_(tilde_k), depth_(depth > 0 ? depth : 1), width_(width > 0 ? width : 1),
+          seed_(seed), eps_(eps), delta_(delta), heap(tilde_k) {
+        buckets_.resize(static_cast<size_t>(depth_) * width_);
+        decay_threshold_.resize(DECAY_TABLE);
+        for (uint32_t c = 0; c < DECAY_TABLE; ++c) {
+            decay_threshold_[c] = static_cast<uint32_t>(min(4294967295.0, 4294967296.0 * pow(DECAY, -static_cast<double>(c))));
+        }
+        seedDecay();
+    }
+
+    void reset(uint32_t seed) override {
+        n_ = 0;
+        seed_ = seed;
+        fill(buckets_.begin(), buckets_.end(), Bucket{});
+        heap.clear();
+        seedDecay();
+        last_release_.clear();
+    }
+
+    // Width giving roughly `bytes` in total for the bucket array plus a full
+    // candidate heap, for comparisons at equal memory.
+    static int widthForBytes(size_t bytes, int depth, size_t tilde_k) {
+        const size_t heap_bytes = tilde_k * (sizeof(pair<int, double>) + 48);
+        const size_t table = bytes > heap_bytes ? bytes - heap_bytes : 0;
+        return max(1, static_cast<int>(table / (static_cast<size_t>(depth) * sizeof(Bucket))));
+    }
+
+    void update(int item) override {
+        ++n_;
+
+        const uint32_t fp = Sketch::hash(item, seed_) | 1;  // 0 marks an empty bucket
+        const uint32_t step = Sketch::hash(item, seed_ + 1) | 1;
+        uint32_t h = fp;
+        uint32_t est = 0;
+
+        for (int i = 0; i < depth_; ++i, h += step) {
+            const size_t cell = static_cast<size_t>(i) * width_ + h % width_;
+            Bucket& b = buckets_[cell];
+            if (b.fp == fp) {
+                est = max(est, ++b.count);
+            } else if (b.count == 0) {
+                b.fp = fp;
+                b.count = 1;
+                est = max(est, 1u);
+            } else if (b.count < DECAY_TABLE && decayCoin(cell, b.fp, b.count) < decay_threshold_[b.count]) {
+                if (--b.count == 0) {
+                    b.fp = fp;
+                    b.count = 1;
+                    est = max(est, 1u);
+                }
+            }
+        }
+
+        const auto est_double = static_cast<double>(est);
+        if (heap.contains(item)) {
+            heap.update(item, est_double);
+        } else if (!heap.full()) {
+            heap.insert(item, est_double);
+        } else if (est_double > heap.min_value()) {
+            heap.replace_top(item, est_double);
+        }
+    }
+
+    vector<pair<int, double>> query() const override {
+        vector<pair<int, double>> out;
+        if (k_ == 0 || eps_ <= 0.0 || delta_ <= 0.0) {
+            return out;
+        }
+
+        const double tau = threshold();
+        for (const auto& p : heap.items()) {
+            const double noisy = p.second + laplaceNoise(eps_, depth_ + 1.0);
+            if (noisy > tau) {
+                out.emplace_back(p.first, noisy);
+            }
+        }
+        return recordRelease(std::move(out));
+    }
+
+    // The noisy count the last query() reported for item, else 0; see
+    // SketchHH.
+    [[nodiscard]] double estimate(int item) const override {
+        return releasedCount(item);
+    }
+
+    [[nodiscard]] size_t tracked_keys() const override {
+        return heap.capacity();
+    }
+
+    MemoryBreakdown memory_breakdown() const override {
+        MemoryBreakdown m;
+        m.add("object", sizeof(*this));
+        m.add("buckets", vectorBytes(buckets_));
+        m.add("decay_table", vectorBytes(decay_threshold_));
+        m.add("heap", heap.memory_breakdown());
+        return m;
+    }
+
+    // Stores the decay key with the buckets, so a reloaded engine decays
+    // exactly as the original would have. Release noise is drawn at query.
+    void save(SnapshotWriter& w) const {
+        const size_t at = w.beginSection(SnapshotKind::HKSO);
+        w.put<uint64_t>(k_);
+        w.put<uint64_t>(tilde_k_);
+        w.put<uint64_t>(n_);
+        w.put<int32_t>(depth_);
+        w.put<int32_t>(width_);
+        w.put<uint32_t>(seed_);
+        w.put<double>(eps_);
+        w.put<double>(delta_);
+        w.put<uint64_t>(decay_key_);
+        vector<uint32_t> fps, counts;
+        fps.reserve(buckets_.size());
+        counts.reserve(buckets_.size());
+        for (const Bucket& b : buckets_) {
+            fps.push_back(b.fp);
+            counts.push_back(b.count);
+        }
+        w.putArray(fps.data(), fps.size());
+        w.putArray(counts.data(), counts.size());
+        heap.save(w);
+        w.endSection(at);
+    }
+
+    static unique_ptr<HKSO> load(SnapshotReader& r) {
+        if (!r.section(SnapshotKind::HKSO)) return nullptr;
+        const auto k = r.get<uint64_t>();
+        const auto tilde_k = r.get<uint64_t>();
+        const auto n = r.get<uint64_t>();
+        const auto depth = r.get<int32_t>();
+        const auto width = r.get<int32_t>();
+        const auto seed = r.get<uint32_t>();
+        const auto eps = r.get<double>();
+        const auto delta = r.get<double>();
+        const auto decay_key = r.get<uint64_t>();
+        if (!r.ok() || depth <= 0 || width <= 0) return nullptr;
+
+        unique_ptr<HKSO> out(new HKSO(k, tilde_k, eps, delta, width, depth, seed));
+        const size_t cells = out->buckets_.size();
+        vector<uint32_t> fps(cells), counts(cells);
+        if (!r.getArray(fps.data(), cells) || !r.getArray(counts.data(), cells)) return nullptr;
+        for (size_t c = 0; c < cells; ++c) out->buckets_[c] = Bucket{fps[c], counts[c]};
+        if (!out->heap.load(r)) return nullptr;
+        out->n_ = n;
+        out->decay_key_ = decay_key;
+        return out;
+    }
+};
+
+#endif //HKSO_H
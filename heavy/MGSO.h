@@ -3,6 +3,7 @@
 #ifndef MGSO_H
 #define MGSO_H
 #include <cmath>
+#include <memory>
 
 #include "MisraGries.h"
 
@@ -19,8 +20,10 @@ private:
 
 public:
 
-    MGSO(size_t k, size_t tilde_k, double eps, double delta)
-            : k_(k), eps_(eps), delta_(delta), n_(0), mg_(new MisraGries(tilde_k)) {}
+    // resource: node and index memory of the summary (see NodeArena).
+    MGSO(size_t k, size_t tilde_k, double eps, double delta,
+         std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : k_(k), eps_(eps), delta_(delta), n_(0), mg_(new MisraGries(tilde_k, resource)) {}
 
 
     ~MGSO() override {
@@ -33,6 +36,18 @@ public:
         ++n_;
     }
 
+    void reset(uint32_t seed) override {
+        mg_->reset(seed);
+        n_ = 0;
+        last_release_.clear();
+    }
+
+    // The noisy count the last query() reported for item, else 0; see
+    // SketchHH.
+    [[nodiscard]] double estimate(int item) const override {
+        return releasedCount(item);
+    }
+
     [[nodiscard]] vector<pair<int, double>> query() const override {
         vector<pair<int, double>> out;
 
@@ -55,7 +70,45 @@ public:
                 out.emplace_back(item, noisy);
             }
         }
-        return out; 
+        return recordRelease(std::move(out));
+    }
+
+    [[nodiscard]] size_t tracked_keys() const override {
+        return mg_->tracked_keys();
+    }
+
+    MemoryBreakdown memory_breakdown() const override {
+        MemoryBreakdown m;
+        m.add("object", sizeof(*this));
+        m.add("summary", mg_->memory_breakdown());
+        return m;
+    }
+
+    // Only the exact summary is stored; noise is drawn at query time.
+    void save(SnapshotWriter& w) const {
+        const size_t at = w.beginSection(SnapshotKind::MGSO);
+        w.put<uint64_t>(k_);
+        w.put<uint64_t>(n_);
+        w.put<double>(eps_);
+        w.put<double>(delta_);
+        mg_->save(w);
+        w.endSection(at);
+    }
+
+    static unique_ptr<MGSO> load(SnapshotReader& r) {
+        if (!r.section(SnapshotKind::MGSO)) return nullptr;
+        const auto k = r.get<uint64_t>();
+        const auto n = r.get<uint64_t>();
+        const auto eps = r.get<double>();
+        const auto delta = r.get<double>();
+        unique_ptr<MisraGries> mg = MisraGries::load(r);
+        if (!mg) return nullptr;
+
+        unique_ptr<MGSO> out(new MGSO(k, 0, eps, delta));
+        delete out->mg_;
+        out->mg_ = mg.release();
+        out->n_ = n;
+        return out;
     }
 };
 
@@ -8,40 +8,37 @@
 #include <cstddef>
 #include <cassert>
 #include <utility>
+#include <memory>
+#include <memory_resource>
+#include <algorithm>
+#include <span>
 
 class MisraGries : public SketchHH {
 public:
-    explicit MisraGries(size_t num_counters)
-    : smallest_(new Parent()), largest_(smallest_) {
+    explicit MisraGries(size_t num_counters,
+                        std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : num_counters_(num_counters),
+          arena_(resource),
+          index_(0, std::hash<int>(), std::equal_to<int>(),
+                 ChildIndex::allocator_type(nullptr, arena_.index_resource())),
+          smallest_(arena_.parent()),
+          largest_(smallest_) {
         index_.reserve(num_counters * 2);
+        Child* children = arena_.children(num_counters);
         for (size_t i = 0; i < num_counters; ++i) {
-            smallest_->Add(new Child());
+            smallest_->Add(&children[i]);
         }
     }
 
-    ~MisraGries() override {
-        Parent* p = smallest_;
-        while (p != nullptr) {
-            if (p->child_) {
-                Child* start = p->child_;
-                Child* it    = start;
-                do {
-                    Child* nxt = it->next_;
-                    delete it;
-                    it = (nxt == start ? nullptr : nxt);
-                } while (it != nullptr);
-            }
-            Parent* nxtp = p->right_;
-            delete p;
-            p = nxtp;
-        }
-        index_.clear();
-    }
-
     void update(int item) override {
         Process(item);
     }
 
+    // The summary has no seed.
+    void reset(uint32_t) override {
+        resetStreamSummary(&smallest_, &largest_, index_, arena_);
+    }
+
     [[nodiscard]] std::vector<std::pair<int, double>> query() const override {
         std::vector<std::pair<int, double>> result;
         Parent* p = largest_;
@@ -62,6 +59,46 @@ public:
         return result;
     }
 
+    // Exact, not private: the counter of a tracked key (an under-estimate),
+    // 0 for an untracked one. The key is one index lookup away, but group
+    // values are stored as differences, so its count is a walk down to the
+    // smallest group; estimate_batch() does one walk for the whole batch.
+    [[nodiscard]] double estimate(int item) const override {
+        auto it = index_.find(item);
+        return it == index_.end() ? 0.0 : static_cast<double>(AbsoluteFor(it->second->parent_));
+    }
+
+    [[nodiscard]] size_t tracked_keys() const override {
+        return num_counters_;
+    }
+
+    MemoryBreakdown memory_breakdown() const override {
+        MemoryBreakdown m;
+        m.add("object", sizeof(*this));
+        m.add("children", arena_.children_bytes());
+        m.add("groups", arena_.groups_bytes());
+        m.add("index", arena_.index_bytes());
+        return m;
+    }
+
+    void save(SnapshotWriter& w) const {
+        const size_t at = w.beginSection(SnapshotKind::MisraGries);
+        saveStreamSummary(w, smallest_, num_counters_);
+        w.endSection(at);
+    }
+
+    static std::unique_ptr<MisraGries> load(SnapshotReader& r,
+                                            std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+        if (!r.section(SnapshotKind::MisraGries)) return nullptr;
+        std::unique_ptr<MisraGries> out(new MisraGries(0, resource));
+        out->arena_.release(out->smallest_);
+        out->smallest_ = out->largest_ = nullptr;
+        if (!loadStreamSummary(r, out->num_counters_, &out->smallest_, &out->largest_,
+                               out->index_, out->arena_)) {
+            return nullptr;
+        }
+        return out;
+    }
 
 void print() const {
         using std::cout;
@@ -110,8 +147,32 @@ void print() const {
         cout << "=== End ===\n";
     }
 
+protected:
+    // Finds the groups of the tracked keys, then walks the groups once from
+    // the smallest, summing the differences into absolute counts.
+    void estimateBatch(std::span<const int> items, std::span<double> out) const override {
+        std::vector<std::pair<const Parent*, size_t>> found;
+        found.reserve(items.size());
+        for (size_t i = 0; i < items.size(); ++i) {
+            auto it = index_.find(items[i]);
+            out[i] = 0.0;
+            if (it != index_.end()) found.emplace_back(it->second->parent_, i);
+        }
+        if (found.empty()) return;
+        std::sort(found.begin(), found.end());
+
+        size_t abs_val = 0;
+        for (const Parent* p = smallest_; p != nullptr; p = p->right_) {
+            abs_val += p->value_;
+            auto at = std::lower_bound(found.begin(), found.end(), std::make_pair(p, size_t{0}));
+            for (; at != found.end() && at->first == p; ++at) out[at->second] = static_cast<double>(abs_val);
+        }
+    }
+
 private:
-    std::unordered_map<int, Child*> index_;
+    size_t num_counters_{0};
+    NodeArena arena_;  // before index_, whose nodes it holds
+    ChildIndex index_;
     Parent* smallest_{nullptr};
     Parent* largest_{nullptr};
 
@@ -147,11 +208,11 @@ private:
             index_[element]  = bucket;
 
             Parent* next_grp = smallest_->right_;
-            Child* moving = bucket->Detach(&smallest_, index_);
+            Child* moving = bucket->Detach(&smallest_, index_, arena_);
             if (next_grp != nullptr && next_grp->value_ == 1) {
                 next_grp->Add(moving);
             } else {
-                auto* p = new Parent();
+                auto* p = arena_.parent();
                 if(smallest_ == next_grp) {
                     smallest_ = p;
                     p->left_ = nullptr;
@@ -184,7 +245,7 @@ private:
             size_t curr_offset = par->value_;
 
             if (next_grp != nullptr && next_grp->value_ == 1) {
-                Child* moving = bucket->Detach(&smallest_, index_);
+                Child* moving = bucket->Detach(&smallest_, index_, arena_);
                 next_grp->value_ += curr_offset;
                 next_grp->Add(moving);
             } else {
@@ -195,11 +256,11 @@ private:
             }
         } else {
             if (next_grp != nullptr && next_grp->value_ == 1) {
-                Child* moving = bucket->Detach(&smallest_, index_);
+                Child* moving = bucket->Detach(&smallest_, index_, arena_);
                 next_grp->Add(moving);
             } else {
-                Child* moving = bucket->Detach(&smallest_, index_);
-                auto* p = new Parent();
+                Child* moving = bucket->Detach(&smallest_, index_, arena_);
+                auto* p = arena_.parent();
                 p->left_ = par;
                 p->value_ = 1;
                 p->right_ = next_grp;
@@ -0,0 +1,68 @@
+
+#ifndef PACKETSAMPLER_H
+#define PACKETSAMPLER_H
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+using namespace std;
+
+// Per-packet Bernoulli sampling at rate p for the sketch-based engines.
+//
+// The admit test hashes a running packet counter with a secret seed
+// (splitmix64), so it costs a multiply-xorshift and no RNG state; keys are
+// not sampled as a whole, so a heavy key is never dropped outright.
+//
+// Privacy: an eps0-DP mechanism run on a Poisson sample at rate p is
+// ln(1 + p(e^eps0 - 1))-DP. To meet a target eps the sketch therefore runs at
+// sketchEps(eps) = ln(1 + (e^eps - 1) / p) > eps, which needs less noise.
+// Sampled counts are rescaled by 1/p, so noise and sampling error are both
+// divided by p in rescaled units; samplingError() gives the latter.
+class PacketSampler {
+public:
+    explicit PacketSampler(double rate = 1.0)
+        : rate_(rate > 0.0 && rate < 1.0 ? rate : 1.0) {
+        threshold_ = static_cast<uint64_t>(rate_ * 18446744073709551616.0);
+        reset();
+    }
+
+    // Starts a new sample: fresh secret seed, counter back to zero.
+    void reset() {
+        random_device rd;
+        seed_ = (static_cast<uint64_t>(rd()) << 32) | rd();
+        counter_ = 0;
+    }
+
+    [[nodiscard]] double rate() const { return rate_; }
+    [[nodiscard]] bool sampling() const { return rate_ < 1.0; }
+
+    bool admit() {
+        uint64_t z = seed_ + (++counter_) * 0x9e3779b97f4a7c15ull;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        z ^= z >> 31;
+        return z < threshold_;
+    }
+
+    // Privacy budget the sketch may spend so that sampling plus sketch
+    // meets eps overall.
+    [[nodiscard]] double sketchEps(double eps) const {
+        return sampling() ? log1p(expm1(eps) / rate_) : eps;
+    }
+
+    // High-probability bound, in rescaled units, on the sampling error of a
+    // key with true count `count`, union-bounded over `candidates` keys.
+    [[nodiscard]] double samplingError(double count, double delta, double candidates) const {
+        if (!sampling() || count <= 0.0) return 0.0;
+        return sqrt(3.0 * count * (1.0 - rate_) / rate_ * log(2.0 * candidates / delta));
+    }
+
+private:
+    double rate_;
+    uint64_t threshold_{0};
+    uint64_t seed_{0};
+    uint64_t counter_{0};
+};
+
+#endif //PACKETSAMPLER_H
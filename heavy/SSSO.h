@@ -3,6 +3,7 @@
 #define SSSO_H
 
 #include <cmath>
+#include <memory>
 
 #include "SketchHH.h"
 #include "SpaceSaving.h"
@@ -18,15 +19,24 @@ private:
 
     SpaceSaving* ss_{nullptr};
 
+    [[nodiscard]] double threshold() const {
+        const double gamma = (1.0 / eps_) * log(2.0 / delta_);
+        const auto n_double = static_cast<double>(n_);
+        return max(n_double / static_cast<double>(k_),
+                   n_double / static_cast<double>(tilde_k_) + 1.0 + gamma);
+    }
+
 public:
 
-    SSSO(size_t k, size_t tilde_k, double eps, double delta)
+    // resource: node and index memory of the summary (see NodeArena).
+    SSSO(size_t k, size_t tilde_k, double eps, double delta,
+         std::pmr::memory_resource* resource = std::pmr::get_default_resource())
            : k_(k),
              tilde_k_(tilde_k),
              eps_(eps),
              delta_(delta),
              n_(0),
-             ss_(new SpaceSaving(tilde_k))
+             ss_(new SpaceSaving(tilde_k, resource))
     {}
 
     ~SSSO() override {
@@ -39,6 +49,18 @@ public:
         ++n_;
     }
 
+    void reset(uint32_t seed) override {
+        ss_->reset(seed);
+        n_ = 0;
+        last_release_.clear();
+    }
+
+    // The noisy count the last query() reported for item, else 0; see
+    // SketchHH.
+    [[nodiscard]] double estimate(int item) const override {
+        return releasedCount(item);
+    }
+
     [[nodiscard]] vector<pair<int, double>> query() const override {
         vector<pair<int, double>> out;
 
@@ -46,13 +68,8 @@ public:
             return out;
         }
 
-        double gamma;
-        gamma = (1.0 / eps_) * log(2.0 / delta_);
         const vector<pair<int, double>> ss_summary = ss_->query();
-
-        const auto n_double = static_cast<double>(n_);
-        const double tau = max(n_double / static_cast<double>(k_),
-                                    n_double / static_cast<double>(tilde_k_) + 1.0 + gamma);
+        const double tau = threshold();
 
         for (const auto& kv : ss_summary) {
             const int item = kv.first;
@@ -64,10 +81,49 @@ public:
                 out.emplace_back(item, noisy);
             }
         }
-        return out;
+        return recordRelease(std::move(out));
+    }
+
+    [[nodiscard]] size_t tracked_keys() const override {
+        return ss_->tracked_keys();
+    }
+
+    MemoryBreakdown memory_breakdown() const override {
+        MemoryBreakdown m;
+        m.add("object", sizeof(*this));
+        m.add("summary", ss_->memory_breakdown());
+        return m;
     }
 
+    // Only the exact summary is stored; noise is drawn at query time.
+    void save(SnapshotWriter& w) const {
+        const size_t at = w.beginSection(SnapshotKind::SSSO);
+        w.put<uint64_t>(k_);
+        w.put<uint64_t>(tilde_k_);
+        w.put<uint64_t>(n_);
+        w.put<double>(eps_);
+        w.put<double>(delta_);
+        ss_->save(w);
+        w.endSection(at);
+    }
 
+    static unique_ptr<SSSO> load(SnapshotReader& r) {
+        if (!r.section(SnapshotKind::SSSO)) return nullptr;
+        const auto k = r.get<uint64_t>();
+        const auto tilde_k = r.get<uint64_t>();
+        const auto n = r.get<uint64_t>();
+        const auto eps = r.get<double>();
+        const auto delta = r.get<double>();
+        unique_ptr<SpaceSaving> ss = SpaceSaving::load(r);
+        if (!ss) return nullptr;
+
+        unique_ptr<SSSO> out(new SSSO(k, 0, eps, delta));
+        delete out->ss_;
+        out->ss_ = ss.release();
+        out->tilde_k_ = tilde_k;
+        out->n_ = n;
+        return out;
+    }
 };
 
 #endif //SSSO_H
@@ -0,0 +1,191 @@
+
+#ifndef SSSOWINDOW_H
+#define SSSOWINDOW_H
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+#include "SketchHH.h"
+#include "SpaceSaving.h"
+
+// Sliding-window SSSO over the last `window` items.
+//
+// The window is split into `num_sub_windows` sub-windows, each summarised by
+// its own exact SpaceSaving with tilde_k counters. When the current
+// sub-window fills up, the oldest one is cleared and reused, so expiry costs
+// O(tilde_k) and never touches the other sub-windows. rotate() may also be
+// called directly for time-based windows.
+//
+// query() releases every live sub-window on its own, exactly as SSSO releases
+// its summary: each counter gets Laplace noise of scale 1/eps and is kept only
+// above that sub-window's threshold n_s/tilde_k + 1 + log(2/delta)/eps, with
+// n_s the items in the sub-window. A neighbouring stream changes exactly one
+// sub-window, so by parallel composition the set of releases is
+// (eps, delta)-DP. Merging is post-processing: released counts are summed per
+// key and keys below window_count()/k are dropped. Summing the exact counts
+// first would not do: one swapped item can decide whether a key holds a
+// counter in a sub-window at all, which moves its merged count by about
+// n_s/tilde_k + 1.
+class SSSOWindow : public SketchHH {
+
+private:
+    size_t k_{0};
+    size_t tilde_k_{0};
+    double eps_{1.0};
+    double delta_{1e-6};
+
+    size_t sub_len_{0};
+    size_t head_{0};
+    vector<SpaceSaving*> ring_;
+    vector<size_t> counts_;
+
+    // SSSO's stability threshold for a sub-window holding n items; the
+    // n/k heavy-hitter cut is applied to the merged counts instead.
+    [[nodiscard]] double subThreshold(size_t n) const {
+        const double gamma = (1.0 / eps_) * log(2.0 / delta_);
+        return static_cast<double>(n) / static_cast<double>(tilde_k_) + 1.0 + gamma;
+    }
+
+public:
+
+    SSSOWindow(size_t k, size_t tilde_k, double eps, double delta,
+               size_t window, size_t num_sub_windows)
+        : k_(k),
+          tilde_k_(tilde_k),
+          eps_(eps),
+          delta_(delta),
+          sub_len_((window + num_sub_windows - 1) / num_sub_windows),
+          ring_(num_sub_windows, nullptr),
+          counts_(num_sub_windows, 0) {
+        for (auto& ss : ring_) ss = new SpaceSaving(tilde_k);
+    }
+
+    ~SSSOWindow() override {
+        for (auto& ss : ring_) delete ss;
+    }
+
+    void update(int item) override {
+        if (sub_len_ != 0 && counts_[head_] >= sub_len_) {
+            rotate();
+        }
+        ring_[head_]->update(item);
+        ++counts_[head_];
+    }
+
+    // Starts a new sub-window, expiring the oldest one.
+    void rotate() {
+        head_ = (head_ + 1) % ring_.size();
+        ring_[head_]->reset(0);
+        counts_[head_] = 0;
+    }
+
+    void reset(uint32_t seed) override {
+        for (auto& ss : ring_) ss->reset(seed);
+        fill(counts_.begin(), counts_.end(), 0);
+        head_ = 0;
+        last_release_.clear();
+    }
+
+    [[nodiscard]] size_t window_count() const {
+        size_t n = 0;
+        for (size_t c : counts_) n += c;
+        return n;
+    }
+
+    [[nodiscard]] vector<pair<int, double>> query() const override {
+        vector<pair<int, double>> out;
+
+        if (k_ == 0 || eps_ <= 0.0 || delta_ <= 0.0) {
+            return out;
+        }
+
+        unordered_map<int, double> merged;
+        merged.reserve(ring_.size() * tilde_k_);
+        for (size_t s = 0; s < ring_.size(); ++s) {
+            if (counts_[s] == 0) continue;
+            const double tau_s = subThreshold(counts_[s]);
+            for (const auto& kv : ring_[s]->query()) {
+                const double noisy = kv.second + laplaceNoise(eps_, /*sensitivity=*/1.0);
+                if (noisy > tau_s) {
+                    merged[kv.first] += noisy;
+                }
+            }
+        }
+
+        const double cut = static_cast<double>(window_count()) / static_cast<double>(k_);
+        for (const auto& kv : merged) {
+            if (kv.second > cut) {
+                out.emplace_back(kv.first, kv.second);
+            }
+        }
+        return recordRelease(std::move(out));
+    }
+
+    // The noisy count the last query() reported for item over its window,
+    // else 0; see SketchHH.
+    [[nodiscard]] double estimate(int item) const override {
+        return releasedCount(item);
+    }
+
+    [[nodiscard]] size_t tracked_keys() const override {
+        return ring_.size() * tilde_k_;
+    }
+
+    MemoryBreakdown memory_breakdown() const override {
+        MemoryBreakdown m;
+        m.add("object", sizeof(*this));
+        m.add("ring", vectorBytes(ring_) + vectorBytes(counts_));
+        for (size_t i = 0; i < ring_.size(); ++i) {
+            m.add("sub" + to_string(i), ring_[i]->memory_breakdown());
+        }
+        return m;
+    }
+
+    // Only the exact sub-window summaries are stored: noise is drawn at
+    // query(), so a reload releases with fresh noise like any later query.
+    void save(SnapshotWriter& w) const {
+        const size_t at = w.beginSection(SnapshotKind::SSSOWindow);
+        w.put<uint64_t>(k_);
+        w.put<uint64_t>(tilde_k_);
+        w.put<double>(eps_);
+        w.put<double>(delta_);
+        w.put<uint64_t>(sub_len_);
+        w.put<uint64_t>(head_);
+        w.put<uint64_t>(ring_.size());
+        vector<uint64_t> counts(counts_.begin(), counts_.end());
+        w.putArray(counts.data(), counts.size());
+        for (const SpaceSaving* ss : ring_) ss->save(w);
+        w.endSection(at);
+    }
+
+    static unique_ptr<SSSOWindow> load(SnapshotReader& r) {
+        if (!r.section(SnapshotKind::SSSOWindow)) return nullptr;
+        const auto k = r.get<uint64_t>();
+        const auto tilde_k = r.get<uint64_t>();
+        const auto eps = r.get<double>();
+        const auto delta = r.get<double>();
+        const auto sub_len = r.get<uint64_t>();
+        const auto head = r.get<uint64_t>();
+        const auto subs = r.get<uint64_t>();
+        if (!r.ok() || subs == 0 || head >= subs) return nullptr;
+        vector<uint64_t> counts(subs);
+        if (!r.getArray(counts.data(), subs)) return nullptr;
+
+        unique_ptr<SSSOWindow> out(new SSSOWindow(k, 0, eps, delta, sub_len * subs, subs));
+        for (size_t s = 0; s < subs; ++s) {
+            unique_ptr<SpaceSaving> ss = SpaceSaving::load(r);
+            if (!ss) return nullptr;
+            delete out->ring_[s];
+            out->ring_[s] = ss.release();
+            out->counts_[s] = counts[s];
+        }
+        out->tilde_k_ = tilde_k;
+        out->sub_len_ = sub_len;
+        out->head_ = head;
+        return out;
+    }
+};
+
+#endif //SSSOWINDOW_H
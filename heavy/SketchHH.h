@@ -2,7 +2,15 @@
 #ifndef SKETCHHH_H
 #define SKETCHHH_H
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <random>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "../help/CountingAllocator.h"
 
 using namespace std;
 
@@ -15,6 +23,36 @@ public:
     virtual void update(int item) = 0;
     virtual vector<std::pair<int, double>> query() const = 0;
 
+    // Estimated count of one key, for point lookups that should not pay for
+    // a full query(). What the value is, and what it costs in privacy, is
+    // stated per engine. Engines that release a noisy candidate list answer
+    // from their most recent query(): the count it reported for the key,
+    // else 0. A lookup is post-processing of that release and spends no
+    // budget; only query() releases anew.
+    [[nodiscard]] virtual double estimate(int item) const = 0;
+
+    // estimate() of items[i] into out[i]. Engines override estimateBatch()
+    // where a batch is cheaper than as many lookups.
+    void estimate_batch(span<const int> items, span<double> out) const {
+        if (out.size() < items.size()) throw invalid_argument("estimate_batch: output shorter than input");
+        estimateBatch(items, out.first(items.size()));
+    }
+
+    // Returns the engine to its freshly built state, reusing the memory it
+    // holds, e.g. to start a new reporting interval. seed replaces the hash
+    // seed(s) of engines that have any; noise and sampling secrets are drawn
+    // anew.
+    virtual void reset(uint32_t seed) = 0;
+
+    // Bytes held by the engine, including the object itself and everything
+    // it owns.
+    virtual MemoryBreakdown memory_breakdown() const = 0;
+    [[nodiscard]] size_t memory_bytes() const { return memory_breakdown().total(); }
+
+    // Number of keys the engine can track at once (its counters or candidate
+    // set capacity).
+    [[nodiscard]] virtual size_t tracked_keys() const = 0;
+
     static double laplaceNoise(double eps, double sensitivity) {
         exponential_distribution<double> exp_dist(eps / sensitivity);
         double noise = exp_dist(rng);
@@ -27,7 +65,31 @@ public:
     }
 
 protected:
-    static mt19937 rng;
+    static thread_local mt19937 rng;
+
+    // The most recent release of an engine that answers estimate() from it,
+    // sorted by key. query() is const, hence mutable; engines clear it in
+    // reset().
+    mutable vector<pair<int, double>> last_release_;
+
+    // Keeps out as the most recent release and returns it.
+    vector<pair<int, double>> recordRelease(vector<pair<int, double>> out) const {
+        last_release_ = out;
+        sort(last_release_.begin(), last_release_.end());
+        return out;
+    }
+
+    // The count the most recent release reported for item, else 0.
+    [[nodiscard]] double releasedCount(int item) const {
+        auto it = lower_bound(last_release_.begin(), last_release_.end(),
+                              make_pair(item, -numeric_limits<double>::infinity()));
+        return it != last_release_.end() && it->first == item ? it->second : 0.0;
+    }
+
+    // Same-sized spans; see estimate_batch().
+    virtual void estimateBatch(span<const int> items, span<double> out) const {
+        for (size_t i = 0; i < items.size(); ++i) out[i] = estimate(items[i]);
+    }
 
     struct Cmp {
         bool operator()(const pair<int,double>& a, const pair<int,double>& b) const {
@@ -38,6 +100,6 @@ protected:
 
 };
 
-mt19937 SketchHH::rng(random_device{}());
+thread_local mt19937 SketchHH::rng(random_device{}());
 
 #endif //SKETCHHH_H
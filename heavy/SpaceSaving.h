@@ -8,42 +8,36 @@
 #include <cstddef>
 #include <cassert>
 #include <utility>
+#include <memory>
+#include <memory_resource>
 
 class SpaceSaving : public SketchHH {
 
 public:
-  explicit SpaceSaving(size_t num_counters)
-      : smallest_(new Parent()),
+  explicit SpaceSaving(size_t num_counters,
+                       std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : num_counters_(num_counters),
+        arena_(resource),
+        index_(0, std::hash<int>(), std::equal_to<int>(),
+               ChildIndex::allocator_type(nullptr, arena_.index_resource())),
+        smallest_(arena_.parent()),
         largest_(smallest_) {
     index_.reserve(num_counters * 2);
+    Child* children = arena_.children(num_counters);
     for (size_t i = 0; i < num_counters; ++i) {
-      smallest_->Add(new Child());
+      smallest_->Add(&children[i]);
     }
   }
 
-  ~SpaceSaving() override {
-    Parent* p = smallest_;
-    while (p != nullptr) {
-      if (p->child_) {
-        Child* start = p->child_;
-        Child* it    = start;
-        do {
-          Child* nxt = it->next_;
-          delete it;
-          it = (nxt == start ? nullptr : nxt);
-        } while (it != nullptr);
-      }
-      Parent* nxtp = p->right_;
-      delete p;
-      p = nxtp;
-    }
-    index_.clear();
-  }
-
   void update(int item) override {
     Process(item);
   }
 
+  // The summary has no seed.
+  void reset(uint32_t) override {
+    resetStreamSummary(&smallest_, &largest_, index_, arena_);
+  }
+
   [[nodiscard]] vector<pair<int, double>> query() const override {
     vector<pair<int, double>> result;
     Parent* p = largest_;
@@ -63,6 +57,45 @@ public:
     return result;
   }
 
+  // Exact, not private: the counter of a tracked key (an over-estimate by
+  // at most the smallest counter), 0 for an untracked one. One index lookup.
+  [[nodiscard]] double estimate(int item) const override {
+    auto it = index_.find(item);
+    return it == index_.end() ? 0.0 : static_cast<double>(it->second->parent_->value_);
+  }
+
+  [[nodiscard]] size_t tracked_keys() const override {
+    return num_counters_;
+  }
+
+  MemoryBreakdown memory_breakdown() const override {
+    MemoryBreakdown m;
+    m.add("object", sizeof(*this));
+    m.add("children", arena_.children_bytes());
+    m.add("groups", arena_.groups_bytes());
+    m.add("index", arena_.index_bytes());
+    return m;
+  }
+
+  void save(SnapshotWriter& w) const {
+    const size_t at = w.beginSection(SnapshotKind::SpaceSaving);
+    saveStreamSummary(w, smallest_, num_counters_);
+    w.endSection(at);
+  }
+
+  static std::unique_ptr<SpaceSaving> load(SnapshotReader& r,
+                                           std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+    if (!r.section(SnapshotKind::SpaceSaving)) return nullptr;
+    std::unique_ptr<SpaceSaving> out(new SpaceSaving(0, resource));
+    out->arena_.release(out->smallest_);
+    out->smallest_ = out->largest_ = nullptr;
+    if (!loadStreamSummary(r, out->num_counters_, &out->smallest_, &out->largest_,
+                           out->index_, out->arena_)) {
+      return nullptr;
+    }
+    return out;
+  }
+
   void print() const {
     using std::cout;
 
@@ -103,7 +136,9 @@ public:
 
 private:
 
-  unordered_map<int, Child*> index_;
+  size_t num_counters_{0};
+  NodeArena arena_;  // before index_, whose nodes it holds
+  ChildIndex index_;
   Parent* smallest_{nullptr};
   Parent* largest_{nullptr};
 
@@ -131,7 +166,7 @@ private:
     const size_t next_count = g->value_ + 1;
 
     if (next_grp != nullptr && next_grp->value_ == next_count) {
-      Child* moving = bucket->Detach(&smallest_, index_);
+      Child* moving = bucket->Detach(&smallest_, index_, arena_);
       next_grp->Add(moving);
     } else if (bucket->next_ == bucket) {
       g->value_ = next_count;
@@ -139,8 +174,8 @@ private:
         largest_ = g;
       }
     } else {
-      Child* moving = bucket->Detach(&smallest_, index_);
-      auto* p = new Parent();
+      Child* moving = bucket->Detach(&smallest_, index_, arena_);
+      auto* p = arena_.parent();
       p->left_  = g;
       p->value_ = next_count;
       p->right_ = next_grp;
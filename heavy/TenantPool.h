@@ -0,0 +1,231 @@
+
+#ifndef TENANTPOOL_H
+#define TENANTPOOL_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "SketchHH.h"
+#include "../heap/FlatMinStore.h"
+#include "../help/CountingAllocator.h"
+
+using namespace std;
+
+// Many independent SSSO-style heavy-hitter engines, one per tenant (customer,
+// VLAN, ...), in shared arenas.
+//
+// Each active tenant owns one slab of tilde_k (key, count) counters in two
+// pool-wide arrays; its header is 16 bytes (slab, counters in use, stream
+// length). A tenant gets a slab on its first update, and release() returns
+// the slab to a free list, so an idle tenant costs its header only and no
+// update allocates once the arena has grown to the working set. Counters
+// follow SpaceSaving: a hit increments, a miss takes a free counter or
+// replaces the smallest one. Slabs are small, so both searches are linear
+// scans (SIMD for the keys), which beats the pointer-linked Stream-Summary
+// of a separate SpaceSaving at these sizes.
+//
+// The release is the one of SSSO, per tenant: each counter gets Laplace
+// noise of scale 1/eps and is reported if it clears
+// tau = max(n/k, n/tilde_k + 1 + ln(2/delta)/eps).
+//
+// Tenant ids index the header array directly; map sparse external ids to
+// dense ones first. Ids run up to MAX_TENANT; larger ones throw out_of_range.
+//
+// Only SSSO-style tenants are pooled. MGSO and CMSSOHH tenants would need
+// their own slab layouts (Misra-Gries decrements, per-tenant sketch rows)
+// and still run as separate engines.
+class TenantPool {
+public:
+    // UINT32_MAX would overflow the counting sort's bucket index.
+    static constexpr uint32_t MAX_TENANT = UINT32_MAX - 1;
+
+    TenantPool(size_t k, size_t tilde_k, double eps, double delta)
+        : k_(k), tilde_k_(tilde_k > 0 ? tilde_k : 1), stride_((tilde_k_ + 7) / 8 * 8),
+          eps_(eps), delta_(delta) {}
+
+    void update(uint32_t tenant, int item) {
+        Header& h = activate(tenant);
+        ++h.n;
+        offer(h, item);
+    }
+
+    // Applies a batch of (tenant, item) updates grouped by tenant, so each
+    // tenant's header and slab are touched once per batch. Grouping is a
+    // counting sort over the tenant ids of the batch, which keeps the order
+    // of each tenant's updates.
+    void update_batch(const vector<pair<uint32_t, int>>& batch) {
+        uint32_t top = 0;
+        for (const auto& u : batch) top = max(top, u.first);
+        checkTenant(top);
+        bucket_.assign(static_cast<size_t>(top) + 2, 0);
+        for (const auto& u : batch) ++bucket_[u.first + 1];
+        for (size_t t = 1; t < bucket_.size(); ++t) bucket_[t] += bucket_[t - 1];
+        scratch_.resize(batch.size());
+        for (const auto& u : batch) scratch_[bucket_[u.first]++] = u;
+
+        for (size_t i = 0; i < scratch_.size();) {
+            const uint32_t tenant = scratch_[i].first;
+            Header& h = activate(tenant);
+            size_t j = i;
+            for (; j < scratch_.size() && scratch_[j].first == tenant; ++j) offer(h, scratch_[j].second);
+            h.n += j - i;
+            i = j;
+        }
+    }
+
+    [[nodiscard]] vector<pair<int, double>> query(uint32_t tenant) const {
+        vector<pair<int, double>> out;
+        if (tenant >= headers_.size() || headers_[tenant].slab == NO_SLAB) return out;
+        if (k_ == 0 || eps_ <= 0.0 || delta_ <= 0.0) return out;
+
+        const Header& h = headers_[tenant];
+        const double gamma = (1.0 / eps_) * log(2.0 / delta_);
+        const auto n_double = static_cast<double>(h.n);
+        const double tau = max(n_double / static_cast<double>(k_),
+                               n_double / static_cast<double>(tilde_k_) + 1.0 + gamma);
+
+        const int* keys = &keys_[slabOffset(h)];
+        const uint32_t* counts = &counts_[slabOffset(h)];
+        for (uint32_t i = 0; i < h.used; ++i) {
+            const double noisy = counts[i] + SketchHH::laplaceNoise(eps_, /*sensitivity=*/1.0);
+            if (noisy > tau) out.emplace_back(keys[i], noisy);
+        }
+        return out;
+    }
+
+    // Forgets a tenant and recycles its slab.
+    void release(uint32_t tenant) {
+        if (tenant >= headers_.size() || headers_[tenant].slab == NO_SLAB) return;
+        free_.push_back(headers_[tenant].slab);
+        headers_[tenant] = Header{};
+        --active_;
+    }
+
+    // Moves the active slabs to the front of the arena and frees the rest.
+    void compact() {
+        // In slab order every slab moves down or stays, so no live slab is
+        // overwritten before it has moved.
+        vector<Header*> live;
+        live.reserve(active_);
+        for (Header& h : headers_) {
+            if (h.slab != NO_SLAB) live.push_back(&h);
+        }
+        sort(live.begin(), live.end(), [](const Header* a, const Header* b) { return a->slab < b->slab; });
+
+        uint32_t next = 0;
+        for (Header* hp : live) {
+            Header& h = *hp;
+            if (h.slab != next) {
+                const size_t from = slabOffset(h);
+                const size_t to = static_cast<size_t>(next) * stride_;
+                copy_n(&keys_[from], stride_, &keys_[to]);
+                copy_n(&counts_[from], stride_, &counts_[to]);
+                h.slab = next;
+            }
+            ++next;
+        }
+        keys_.resize(static_cast<size_t>(next) * stride_);
+        counts_.resize(static_cast<size_t>(next) * stride_);
+        keys_.shrink_to_fit();
+        counts_.shrink_to_fit();
+        free_.clear();
+        free_.shrink_to_fit();
+        vector<pair<uint32_t, int>>().swap(scratch_);
+        vector<uint32_t>().swap(bucket_);
+    }
+
+    [[nodiscard]] size_t tenants() const { return headers_.size(); }
+    [[nodiscard]] size_t active() const { return active_; }
+    [[nodiscard]] uint64_t stream_length(uint32_t tenant) const {
+        return tenant < headers_.size() ? headers_[tenant].n : 0;
+    }
+
+    MemoryBreakdown memory_breakdown() const {
+        MemoryBreakdown m;
+        m.add("object", sizeof(*this));
+        m.add("headers", vectorBytes(headers_));
+        m.add("keys", vectorBytes(keys_));
+        m.add("counts", vectorBytes(counts_));
+        m.add("free_list", vectorBytes(free_));
+        m.add("scratch", vectorBytes(scratch_) + vectorBytes(bucket_));
+        return m;
+    }
+    [[nodiscard]] size_t memory_bytes() const { return memory_breakdown().total(); }
+
+private:
+    static constexpr uint32_t NO_SLAB = UINT32_MAX;
+
+    struct Header {
+        uint32_t slab{NO_SLAB};
+        uint32_t used{0};
+        uint64_t n{0};
+    };
+
+    size_t k_;
+    size_t tilde_k_;
+    size_t stride_;  // tilde_k rounded up to 8 for the SIMD key scan
+    double eps_;
+    double delta_;
+
+    vector<Header> headers_;
+    vector<int> keys_;
+    vector<uint32_t> counts_;
+    vector<uint32_t> free_;
+    vector<pair<uint32_t, int>> scratch_;  // update_batch() working space
+    vector<uint32_t> bucket_;
+    size_t active_{0};
+
+    [[nodiscard]] size_t slabOffset(const Header& h) const { return static_cast<size_t>(h.slab) * stride_; }
+
+    static void checkTenant(uint32_t tenant) {
+        if (tenant > MAX_TENANT) throw out_of_range("TenantPool: tenant id above MAX_TENANT");
+    }
+
+    Header& activate(uint32_t tenant) {
+        checkTenant(tenant);
+        if (tenant >= headers_.size()) headers_.resize(static_cast<size_t>(tenant) + 1);
+        Header& h = headers_[tenant];
+        if (h.slab != NO_SLAB) return h;
+
+        if (!free_.empty()) {
+            h.slab = free_.back();
+            free_.pop_back();
+        } else {
+            h.slab = static_cast<uint32_t>(keys_.size() / stride_);
+            keys_.resize(keys_.size() + stride_);
+            counts_.resize(counts_.size() + stride_);
+        }
+        h.used = 0;
+        ++active_;
+        return h;
+    }
+
+    void offer(Header& h, int item) {
+        int* keys = &keys_[slabOffset(h)];
+        uint32_t* counts = &counts_[slabOffset(h)];
+
+        const long hit = FlatMinStore::scan(keys, h.used, item);
+        if (hit >= 0) {
+            ++counts[hit];
+            return;
+        }
+        if (h.used < tilde_k_) {
+            keys[h.used] = item;
+            counts[h.used] = 1;
+            ++h.used;
+            return;
+        }
+        uint32_t smallest = 0;
+        for (uint32_t i = 1; i < h.used; ++i) {
+            if (counts[i] < counts[smallest]) smallest = i;
+        }
+        keys[smallest] = item;
+        ++counts[smallest];
+    }
+};
+
+#endif //TENANTPOOL_H
@@ -0,0 +1,117 @@
+
+#ifndef COUNTINGALLOCATOR_H
+#define COUNTINGALLOCATOR_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Named byte counts for one structure, e.g. {"table", 1048576}.
+struct MemoryBreakdown {
+    std::vector<std::pair<std::string, std::size_t>> parts;
+
+    void add(const std::string& name, std::size_t bytes) {
+        parts.emplace_back(name, bytes);
+    }
+
+    // Adds every part of other under "prefix.".
+    void add(const std::string& prefix, const MemoryBreakdown& other) {
+        for (const auto& p : other.parts) {
+            parts.emplace_back(prefix + "." + p.first, p.second);
+        }
+    }
+
+    [[nodiscard]] std::size_t total() const {
+        std::size_t sum = 0;
+        for (const auto& p : parts) sum += p.second;
+        return sum;
+    }
+};
+
+// Allocator that adds every allocation to an external byte counter. Used for
+// the node-based containers (unordered_map indexes) whose per-node and bucket
+// overheads are implementation specific. A default-constructed allocator
+// counts nothing. Memory comes from resource if one is given, PMR-style, and
+// from operator new otherwise.
+template<typename T>
+class CountingAllocator {
+public:
+    using value_type = T;
+
+    CountingAllocator() noexcept = default;
+    explicit CountingAllocator(std::size_t* counter, std::pmr::memory_resource* resource = nullptr) noexcept
+        : counter_(counter), resource_(resource) {}
+
+    template<typename U>
+    CountingAllocator(const CountingAllocator<U>& other) noexcept
+        : counter_(other.counter()), resource_(other.resource()) {}
+
+    T* allocate(std::size_t n) {
+        if (counter_) *counter_ += n * sizeof(T);
+        if (resource_) return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        if (counter_) *counter_ -= n * sizeof(T);
+        if (resource_) resource_->deallocate(p, n * sizeof(T), alignof(T));
+        else std::allocator<T>().deallocate(p, n);
+    }
+
+    [[nodiscard]] std::size_t* counter() const noexcept { return counter_; }
+    [[nodiscard]] std::pmr::memory_resource* resource() const noexcept { return resource_; }
+
+    template<typename U>
+    bool operator==(const CountingAllocator<U>& other) const noexcept {
+        return counter_ == other.counter() && resource_ == other.resource();
+    }
+
+    template<typename U>
+    bool operator!=(const CountingAllocator<U>& other) const noexcept {
+        return !(*this == other);
+    }
+
+private:
+    std::size_t* counter_{nullptr};
+    std::pmr::memory_resource* resource_{nullptr};
+};
+
+// memory_resource that forwards to upstream and keeps the bytes it currently
+// holds from it. Put one between an arena and its upstream to measure what
+// the arena really takes, chunk slack and free slots included.
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream) noexcept : upstream_(upstream) {}
+
+    [[nodiscard]] std::size_t bytes() const noexcept { return bytes_; }
+
+private:
+    std::pmr::memory_resource* upstream_;
+    std::size_t bytes_{0};
+
+    void* do_allocate(std::size_t bytes, std::size_t align) override {
+        void* p = upstream_->allocate(bytes, align);
+        bytes_ += bytes;
+        return p;
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+        bytes_ -= bytes;
+        upstream_->deallocate(p, bytes, align);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+// Heap bytes held by a vector's buffer.
+template<typename V>
+std::size_t vectorBytes(const V& v) {
+    return v.capacity() * sizeof(typename V::value_type);
+}
+
+#endif //COUNTINGALLOCATOR_H
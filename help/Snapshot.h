@@ -0,0 +1,260 @@
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Versioned binary snapshots of sketches, heaps and summaries.
+//
+// A snapshot is a sequence of sections. Each section starts with a 16-byte
+// header (magic "DPSN", format version, kind, payload length) followed by
+// the payload; composite engines nest the sections of their parts. Every
+// value is little-endian. Flat arrays (sketch tables, heap entries) start on
+// a 64-byte boundary measured from the start of the snapshot, so a file
+// mapped with MappedFile can be read in place through SnapshotReader::view()
+// without copying.
+
+static constexpr uint32_t SNAPSHOT_MAGIC = 0x4e535044; // "DPSN"
+static constexpr uint16_t SNAPSHOT_VERSION = 2; // 2: sample rate in CMSSOHH/CSSOHH
+static constexpr size_t SNAPSHOT_ALIGN = 64;
+
+enum class SnapshotKind : uint16_t {
+    CMSSO = 1,
+    CSSO = 2,
+    IndexMinHeap = 3,
+    SpaceSaving = 4,
+    MisraGries = 5,
+    SSSO = 6,
+    MGSO = 7,
+    CMSSOHH = 8,
+    CSSOHH = 9,
+    SSSOWindow = 10,
+    CMSSOHHWindow = 11,
+    ContinualCMSSOHH = 12,
+    HHHSSSO = 13,
+    HKSO = 14,
+};
+
+namespace snapshot_detail {
+    template<typename T>
+    T toLittle(T v) {
+        static_assert(is_trivially_copyable_v<T>);
+        if constexpr (endian::native == endian::little || sizeof(T) == 1) {
+            return v;
+        } else {
+            unsigned char b[sizeof(T)];
+            memcpy(b, &v, sizeof(T));
+            for (size_t i = 0; i < sizeof(T) / 2; ++i) swap(b[i], b[sizeof(T) - 1 - i]);
+            memcpy(&v, b, sizeof(T));
+            return v;
+        }
+    }
+}
+
+class SnapshotWriter {
+public:
+    template<typename T>
+    void put(T v) {
+        v = snapshot_detail::toLittle(v);
+        const auto* p = reinterpret_cast<const uint8_t*>(&v);
+        buf_.insert(buf_.end(), p, p + sizeof(T));
+    }
+
+    // Unsigned LEB128, used by the compact Stream-Summary encoding.
+    void putVarint(uint64_t v) {
+        while (v >= 0x80) {
+            buf_.push_back(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        buf_.push_back(static_cast<uint8_t>(v));
+    }
+
+    void putBytes(const void* p, size_t n) {
+        const auto* b = static_cast<const uint8_t*>(p);
+        buf_.insert(buf_.end(), b, b + n);
+    }
+
+    // Aligned flat array, readable in place with SnapshotReader::view().
+    template<typename T>
+    void putArray(const T* p, size_t n) {
+        align();
+        if constexpr (endian::native == endian::little) {
+            putBytes(p, n * sizeof(T));
+        } else {
+            for (size_t i = 0; i < n; ++i) put(p[i]);
+        }
+    }
+
+    void align() {
+        buf_.resize((buf_.size() + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN, 0);
+    }
+
+    // Returns a token for endSection(), which back-fills the payload length.
+    size_t beginSection(SnapshotKind kind) {
+        const size_t at = buf_.size();
+        put(SNAPSHOT_MAGIC);
+        put(SNAPSHOT_VERSION);
+        put(static_cast<uint16_t>(kind));
+        put(uint64_t{0});
+        return at;
+    }
+
+    void endSection(size_t at) {
+        const uint64_t len = snapshot_detail::toLittle<uint64_t>(buf_.size() - at - 16);
+        memcpy(buf_.data() + at + 8, &len, sizeof(len));
+    }
+
+    [[nodiscard]] const vector<uint8_t>& bytes() const { return buf_; }
+
+    bool writeFile(const string& path) const {
+        ofstream out(path, ios::binary | ios::trunc);
+        out.write(reinterpret_cast<const char*>(buf_.data()), static_cast<streamsize>(buf_.size()));
+        return static_cast<bool>(out);
+    }
+
+private:
+    vector<uint8_t> buf_;
+};
+
+// Reads a snapshot from memory (a loaded buffer or a MappedFile). Any
+// malformed or truncated input clears ok(); later reads then return zeros and
+// the loaders give up, so no read runs past the end of the data.
+class SnapshotReader {
+public:
+    SnapshotReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+    explicit SnapshotReader(const vector<uint8_t>& bytes) : data_(bytes.data()), size_(bytes.size()) {}
+
+    [[nodiscard]] bool ok() const { return ok_; }
+    [[nodiscard]] size_t position() const { return pos_; }
+
+    template<typename T>
+    T get() {
+        T v{};
+        if (!need(sizeof(T))) return v;
+        memcpy(&v, data_ + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return snapshot_detail::toLittle(v);
+    }
+
+    uint64_t getVarint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const auto b = get<uint8_t>();
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        ok_ = false;
+        return 0;
+    }
+
+    const uint8_t* getBytes(size_t n) {
+        if (!need(n)) return nullptr;
+        const uint8_t* p = data_ + pos_;
+        pos_ += n;
+        return p;
+    }
+
+    // Copies an array written by SnapshotWriter::putArray().
+    template<typename T>
+    bool getArray(T* out, size_t n) {
+        align();
+        if (!need(n * sizeof(T))) return false;
+        if constexpr (endian::native == endian::little) {
+            memcpy(out, data_ + pos_, n * sizeof(T));
+            pos_ += n * sizeof(T);
+        } else {
+            for (size_t i = 0; i < n; ++i) out[i] = get<T>();
+        }
+        return true;
+    }
+
+    // Zero-copy access to an array written by putArray(). Needs a
+    // little-endian host and a base address aligned for T, which holds for
+    // mmap'd files and for vector<uint8_t> buffers on common allocators.
+    template<typename T>
+    const T* view(size_t n) {
+        align();
+        if constexpr (endian::native != endian::little) {
+            ok_ = false;
+            return nullptr;
+        }
+        if (reinterpret_cast<uintptr_t>(data_ + pos_) % alignof(T) != 0) ok_ = false;
+        if (!need(n * sizeof(T))) return nullptr;
+        const auto* p = reinterpret_cast<const T*>(data_ + pos_);
+        pos_ += n * sizeof(T);
+        return p;
+    }
+
+    void align() {
+        const size_t next = (pos_ + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+        if (need(next - pos_)) pos_ = next;
+    }
+
+    // Consumes a section header of the expected kind; returns false (and
+    // clears ok()) on a wrong magic, kind, version or a truncated payload.
+    bool section(SnapshotKind kind) {
+        const auto magic = get<uint32_t>();
+        const auto version = get<uint16_t>();
+        const auto k = get<uint16_t>();
+        const auto len = get<uint64_t>();
+        if (!ok_ || magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION
+            || k != static_cast<uint16_t>(kind) || len > size_ - pos_) {
+            ok_ = false;
+        }
+        return ok_;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_{0};
+    bool ok_{true};
+
+    bool need(size_t n) {
+        if (!ok_ || n > size_ - pos_) {
+            ok_ = false;
+            return false;
+        }
+        return true;
+    }
+};
+
+// (key, value) pairs, e.g. a stored release, as two aligned arrays.
+template<typename K, typename V>
+void savePairs(SnapshotWriter& w, const vector<pair<K, V>>& pairs) {
+    vector<K> keys;
+    vector<V> vals;
+    keys.reserve(pairs.size());
+    vals.reserve(pairs.size());
+    for (const auto& p : pairs) {
+        keys.push_back(p.first);
+        vals.push_back(p.second);
+    }
+    w.put<uint64_t>(pairs.size());
+    w.putArray(keys.data(), keys.size());
+    w.putArray(vals.data(), vals.size());
+}
+
+template<typename K, typename V>
+bool loadPairs(SnapshotReader& r, vector<pair<K, V>>& pairs) {
+    const auto n = r.get<uint64_t>();
+    if (!r.ok()) return false;
+    vector<K> keys(n);
+    vector<V> vals(n);
+    if (!r.getArray(keys.data(), n) || !r.getArray(vals.data(), n)) return false;
+    pairs.clear();
+    pairs.reserve(n);
+    for (size_t i = 0; i < n; ++i) pairs.emplace_back(keys[i], vals[i]);
+    return true;
+}
+
+#endif //SNAPSHOT_H
@@ -4,12 +4,26 @@
 #define NODES_H
 
 #include <unordered_map>
+#include <algorithm>
 #include <cstddef>
 #include <cassert>
+#include <functional>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+#include "CountingAllocator.h"
+#include "Snapshot.h"
 
 
 class Parent;
 class Child;
+class NodeArena;
+
+// Item -> bucket index shared by the Stream-Summary engines; its memory
+// comes from, and is counted by, the owning engine's NodeArena.
+using ChildIndex = std::unordered_map<int, Child*, std::hash<int>, std::equal_to<int>,
+                                      CountingAllocator<std::pair<const int, Child*>>>;
 
 
 class Child {
@@ -17,7 +31,7 @@ public:
     Child() noexcept
         : parent_(nullptr), next_(nullptr), element_(0), in_use_(false) {}
 
-    Child* Detach(Parent** smallest, std::unordered_map<int, Child*>& index);
+    Child* Detach(Parent** smallest, ChildIndex& index, NodeArena& arena);
 
     Parent* parent_;
     Child*  next_;
@@ -38,6 +52,157 @@ public:
     std::size_t value_; // absolute group count
 };
 
+// Fixed-size slots carved from chunks of upstream memory and recycled
+// through a free list threaded through the free slots. Chunks double, so n
+// live slots took O(log n) upstream allocations, and the destructor returns
+// the chunks without visiting the slots.
+class SlotPool {
+public:
+    SlotPool(std::size_t slot_bytes, std::pmr::memory_resource* upstream)
+        : slot_bytes_((std::max(slot_bytes, sizeof(void*)) + alignof(std::max_align_t) - 1)
+                      / alignof(std::max_align_t) * alignof(std::max_align_t)),
+          upstream_(upstream) {}
+
+    SlotPool(const SlotPool&) = delete;
+    SlotPool& operator=(const SlotPool&) = delete;
+
+    ~SlotPool() {
+        for (const auto& chunk : chunks_) {
+            upstream_->deallocate(chunk.first, chunk.second * slot_bytes_, alignof(std::max_align_t));
+        }
+    }
+
+    void* take() {
+        if (free_ == nullptr) grow();
+        void* p = free_;
+        free_ = *static_cast<void**>(p);
+        return p;
+    }
+
+    void give(void* p) noexcept {
+        *static_cast<void**>(p) = free_;
+        free_ = p;
+    }
+
+    [[nodiscard]] std::size_t slot_bytes() const { return slot_bytes_; }
+    [[nodiscard]] std::size_t bytes() const { return slots_ * slot_bytes_; }
+
+private:
+    static constexpr std::size_t FIRST_CHUNK = 8;
+
+    std::size_t slot_bytes_;
+    std::pmr::memory_resource* upstream_;
+    std::vector<std::pair<void*, std::size_t>> chunks_;
+    std::size_t slots_{0};
+    void* free_{nullptr};
+
+    void grow() {
+        const std::size_t n = slots_ == 0 ? FIRST_CHUNK : slots_;
+        auto* chunk = static_cast<unsigned char*>(upstream_->allocate(n * slot_bytes_, alignof(std::max_align_t)));
+        chunks_.emplace_back(chunk, n);
+        slots_ += n;
+        for (std::size_t i = n; i-- > 0;) give(chunk + i * slot_bytes_);
+    }
+};
+
+// Node storage of one Stream-Summary engine.
+//
+// The children are one block, sized once per summary. Groups come and go on
+// every update and are recycled through a SlotPool. The index is an
+// unordered_map whose entries are all one size: they are recycled the same
+// way, and only its bucket array goes upstream. After warm-up an update
+// never reaches the upstream allocator, and since both node types are
+// trivially destructible, teardown returns a few chunks instead of freeing
+// every node.
+//
+// upstream is the PMR injection point: pass a monotonic_buffer_resource to
+// place an engine, or many short-lived ones, in a caller-owned buffer. Each
+// of the three parts reaches upstream through its own CountingResource, so
+// the byte counts below are what the arena holds, not per-node estimates.
+class NodeArena {
+public:
+    explicit NodeArena(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : children_upstream_(upstream), groups_upstream_(upstream), index_upstream_(upstream),
+          groups_(sizeof(Parent), &groups_upstream_), index_(&index_upstream_) {}
+
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+
+    ~NodeArena() { releaseChildren(); }
+
+    // n fresh children; replaces the block of an earlier call.
+    Child* children(std::size_t n) {
+        releaseChildren();
+        if (n == 0) return nullptr;
+        children_ = static_cast<Child*>(children_upstream_.allocate(n * sizeof(Child), alignof(Child)));
+        num_children_ = n;
+        for (std::size_t i = 0; i < n; ++i) ::new (children_ + i) Child();
+        return children_;
+    }
+
+    // The current block of children, rebuilt fresh in place.
+    Child* rebuild_children() {
+        for (std::size_t i = 0; i < num_children_; ++i) ::new (children_ + i) Child();
+        return children_;
+    }
+
+    [[nodiscard]] std::size_t num_children() const { return num_children_; }
+
+    Parent* parent() { return ::new (groups_.take()) Parent(); }
+    void release(Parent* p) noexcept { groups_.give(p); }
+
+    // Resource for the engine's ChildIndex.
+    [[nodiscard]] std::pmr::memory_resource* index_resource() noexcept { return &index_; }
+
+    [[nodiscard]] std::size_t children_bytes() const { return children_upstream_.bytes(); }
+    [[nodiscard]] std::size_t groups_bytes() const { return groups_upstream_.bytes(); }
+    // Bucket arrays and entry chunks, free entries included.
+    [[nodiscard]] std::size_t index_bytes() const { return index_upstream_.bytes(); }
+
+private:
+    // Map entries (a few pointers) from a SlotPool, anything larger from
+    // upstream.
+    class IndexResource : public std::pmr::memory_resource {
+    public:
+        explicit IndexResource(std::pmr::memory_resource* upstream)
+            : upstream_(upstream), slots_(4 * sizeof(void*), upstream) {}
+
+    private:
+        std::pmr::memory_resource* upstream_;
+        SlotPool slots_;
+
+        bool small(std::size_t bytes, std::size_t align) const {
+            return bytes <= slots_.slot_bytes() && align <= alignof(std::max_align_t);
+        }
+
+        void* do_allocate(std::size_t bytes, std::size_t align) override {
+            return small(bytes, align) ? slots_.take() : upstream_->allocate(bytes, align);
+        }
+
+        void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+            if (small(bytes, align)) slots_.give(p);
+            else upstream_->deallocate(p, bytes, align);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+
+    CountingResource children_upstream_;
+    CountingResource groups_upstream_;
+    CountingResource index_upstream_;
+    SlotPool groups_;
+    IndexResource index_;
+    Child* children_{nullptr};
+    std::size_t num_children_{0};
+
+    void releaseChildren() noexcept {
+        if (children_) children_upstream_.deallocate(children_, num_children_ * sizeof(Child), alignof(Child));
+        children_ = nullptr;
+        num_children_ = 0;
+    }
+};
 
 
 inline void Parent::Add(Child* c) noexcept {
@@ -53,7 +218,7 @@ inline void Parent::Add(Child* c) noexcept {
     child_ = c;
 }
 
-inline Child* Child::Detach(Parent** smallest, std::unordered_map<int, Child*>& index) {
+inline Child* Child::Detach(Parent** smallest, ChildIndex& index, NodeArena& arena) {
     assert(parent_ && smallest);
 
     if (next_ == this) {
@@ -67,7 +232,7 @@ inline Child* Child::Detach(Parent** smallest, std::unordered_map<int, Child*>&
         }
         parent_ = nullptr;
         next_   = nullptr;
-        delete grp;
+        arena.release(grp);
         return this;
     }
     if (parent_->child_ == next_) {
@@ -90,4 +255,108 @@ inline Child* Child::Detach(Parent** smallest, std::unordered_map<int, Child*>&
     return removed;
 }
 
+// Rewinds a summary to its state after construction: one group of value 0
+// holding every child of the arena, unused, and an empty index. No memory
+// is returned upstream.
+inline void resetStreamSummary(Parent** smallest, Parent** largest, ChildIndex& index, NodeArena& arena) {
+    for (Parent* p = *smallest; p != nullptr;) {
+        Parent* next = p->right_;
+        arena.release(p);
+        p = next;
+    }
+    index.clear();
+    *smallest = *largest = arena.parent();
+    Child* children = arena.rebuild_children();
+    for (size_t i = 0; i < arena.num_children(); ++i) (*smallest)->Add(&children[i]);
+}
+
+// Compact Stream-Summary encoding shared by SpaceSaving and MisraGries.
+//
+// Groups are written from smallest to largest as varint(value),
+// varint(children), an in-use bitmap, then the int32 elements of the in-use
+// children. Children are listed in ring order starting at child_, so the
+// bucket evicted next is the same after a reload. Unused counters cost one
+// bit and groups cost a few bytes, instead of the pointer-sized fields of
+// the in-memory nodes.
+inline void saveStreamSummary(SnapshotWriter& w, const Parent* smallest, size_t num_counters) {
+    size_t groups = 0;
+    for (const Parent* p = smallest; p != nullptr; p = p->right_) ++groups;
+    w.putVarint(num_counters);
+    w.putVarint(groups);
+
+    vector<uint8_t> bits;
+    for (const Parent* p = smallest; p != nullptr; p = p->right_) {
+        size_t n = 0;
+        if (p->child_) {
+            const Child* c = p->child_;
+            do { ++n; c = c->next_; } while (c != p->child_);
+        }
+        w.putVarint(p->value_);
+        w.putVarint(n);
+
+        bits.assign((n + 7) / 8, 0);
+        const Child* c = p->child_;
+        for (size_t i = 0; i < n; ++i, c = c->next_) {
+            if (c->in_use_) bits[i / 8] |= static_cast<uint8_t>(1u << (i % 8));
+        }
+        w.putBytes(bits.data(), bits.size());
+        c = p->child_;
+        for (size_t i = 0; i < n; ++i, c = c->next_) {
+            if (c->in_use_) w.put<int32_t>(c->element_);
+        }
+    }
+}
+
+// Rebuilds a summary written by saveStreamSummary() into arena. *smallest
+// must be null on entry. Groups are linked as they are decoded, so on failure
+// the partial list is still well formed; the arena owns every node either
+// way.
+inline bool loadStreamSummary(SnapshotReader& r, size_t& num_counters,
+                              Parent** smallest, Parent** largest, ChildIndex& index, NodeArena& arena) {
+    assert(*smallest == nullptr);
+    num_counters = r.getVarint();
+    const uint64_t groups = r.getVarint();
+    if (!r.ok()) return false;
+
+    index.clear();
+    index.reserve(num_counters * 2);
+    Child* next_child = arena.children(num_counters);
+
+    size_t seen = 0;
+    Parent* prev = nullptr;
+    for (uint64_t g = 0; g < groups; ++g) {
+        Parent* p = arena.parent();
+        p->left_ = prev;
+        if (prev) prev->right_ = p; else *smallest = p;
+        *largest = prev = p;
+
+        p->value_ = r.getVarint();
+        const uint64_t n = r.getVarint();
+        if (!r.ok() || n > num_counters - seen) return false;
+        const uint8_t* bits = r.getBytes((n + 7) / 8);
+        if (!bits) return false;
+
+        Child* ring = next_child;
+        for (size_t i = 0; i < n; ++i) {
+            if (bits[i / 8] & (1u << (i % 8))) {
+                ring[i].element_ = r.get<int32_t>();
+                ring[i].in_use_ = true;
+            }
+        }
+        if (!r.ok()) return false;
+        for (size_t i = 0; i < n; ++i) {
+            if (ring[i].in_use_) index[ring[i].element_] = &ring[i];
+        }
+        // Add() makes the newest child the ring head, so add the saved head
+        // last to restore the saved ring order.
+        for (size_t i = 1; i < n; ++i) p->Add(&ring[i]);
+        if (n > 0) p->Add(&ring[0]);
+        next_child += n;
+        seen += n;
+    }
+
+    if (*smallest == nullptr) *smallest = *largest = arena.parent();
+    return seen == num_counters;
+}
+
 #endif // NODES_H
\ No newline at end of file
@@ -0,0 +1,315 @@
+
+#ifndef CSVIPREADER_H
+#define CSVIPREADER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// Parses a dotted-quad IPv4 address in [begin, end). Surrounding double quotes
+// and a trailing '\r' are ignored. Returns false on anything that is not
+// exactly four decimal octets in [0, 255].
+inline bool parseIPv4(const char* begin, const char* end, uint32_t& out) {
+    if (end > begin && end[-1] == '\r') --end;
+    if (end - begin >= 2 && *begin == '"' && end[-1] == '"') {
+        ++begin;
+        --end;
+    }
+
+    uint32_t result = 0;
+    const char* p = begin;
+    for (int octet = 0; octet < 4; ++octet) {
+        uint32_t part = 0;
+        int digits = 0;
+        while (p < end && digits < 4 && static_cast<unsigned>(*p - '0') <= 9) {
+            part = part * 10 + static_cast<uint32_t>(*p - '0');
+            ++p;
+            ++digits;
+        }
+        if (digits == 0 || digits > 3 || part > 255) return false;
+        result = (result << 8) | part;
+
+        if (octet < 3) {
+            if (p == end || *p != '.') return false;
+            ++p;
+        }
+    }
+    if (p != end) return false;
+
+    out = result;
+    return true;
+}
+
+// Chunked reader that pulls one IPv4 column out of a CSV file.
+//
+// The file is read in fixed-size chunks into a buffer allocated once; the
+// separators are located with SIMD compares, and the selected field is parsed
+// in place. Keys are delivered in batches to a sink callable as
+// sink(const int* keys, size_t n). Quoted separators are not honoured for the
+// fields before the selected column, matching the previous getline loader.
+class CsvIpReader {
+public:
+    static constexpr size_t CHUNK_BYTES = 1u << 22;
+    static constexpr size_t BATCH_ITEMS = 1u << 16;
+
+    CsvIpReader(const string& path, int column, bool skip_header = true)
+        : column_(column), skip_header_(skip_header) {
+        file_ = fopen(path.c_str(), "rb");
+        buffer_.resize(2 * CHUNK_BYTES);
+    }
+
+    ~CsvIpReader() {
+        if (file_) fclose(file_);
+    }
+
+    CsvIpReader(const CsvIpReader&) = delete;
+    CsvIpReader& operator=(const CsvIpReader&) = delete;
+
+    [[nodiscard]] bool ok() const { return file_ != nullptr; }
+
+    [[nodiscard]] size_t lines() const { return lines_; }
+    [[nodiscard]] size_t rejected() const { return rejected_; }
+    [[nodiscard]] size_t bytes() const { return bytes_; }
+
+    // Parses the whole file on the calling thread. Returns the number of keys.
+    template<typename Sink>
+    size_t run(Sink&& sink) {
+        vector<int> batch(BATCH_ITEMS);
+        size_t total = 0;
+        parse([&](const int* keys, size_t n) {
+            sink(keys, n);
+            total += n;
+        }, batch.data());
+        return total;
+    }
+
+    // Parses on a background thread and hands batches to sink on the calling
+    // thread. num_batches buffers are allocated up front and recycled.
+    template<typename Sink>
+    size_t run_async(Sink&& sink, size_t num_batches = 4) {
+        struct Batch {
+            vector<int> keys;
+            size_t n{0};
+        };
+        vector<Batch> pool(num_batches < 2 ? 2 : num_batches);
+        for (auto& b : pool) b.keys.resize(BATCH_ITEMS);
+
+        mutex m;
+        condition_variable cv;
+        deque<Batch*> free_list;
+        deque<Batch*> ready;
+        bool done = false;
+        for (auto& b : pool) free_list.push_back(&b);
+
+        auto acquire = [&]() {
+            unique_lock<mutex> lock(m);
+            cv.wait(lock, [&] { return !free_list.empty(); });
+            Batch* b = free_list.front();
+            free_list.pop_front();
+            return b;
+        };
+
+        thread producer([&] {
+            Batch* current = acquire();
+            parse([&](const int*, size_t n) {
+                current->n = n;
+                {
+                    lock_guard<mutex> lock(m);
+                    ready.push_back(current);
+                }
+                cv.notify_all();
+                current = acquire();
+            }, current->keys.data(), [&]() { return current->keys.data(); });
+            {
+                lock_guard<mutex> lock(m);
+                free_list.push_back(current);
+                done = true;
+            }
+            cv.notify_all();
+        });
+
+        size_t total = 0;
+        while (true) {
+            Batch* b;
+            {
+                unique_lock<mutex> lock(m);
+                cv.wait(lock, [&] { return !ready.empty() || done; });
+                if (ready.empty()) break;
+                b = ready.front();
+                ready.pop_front();
+            }
+            sink(static_cast<const int*>(b->keys.data()), b->n);
+            total += b->n;
+            {
+                lock_guard<mutex> lock(m);
+                free_list.push_back(b);
+            }
+            cv.notify_all();
+        }
+        producer.join();
+        return total;
+    }
+
+private:
+    FILE* file_{nullptr};
+    int column_;
+    bool skip_header_;
+    vector<char> buffer_;
+
+    size_t lines_{0};
+    size_t rejected_{0};
+    size_t bytes_{0};
+
+    // Returns the first position in [p, end) holding a or b, or end.
+    static const char* find_either(const char* p, const char* end, char a, char b) {
+#if defined(__AVX2__)
+        const __m256i va = _mm256_set1_epi8(a);
+        const __m256i vb = _mm256_set1_epi8(b);
+        while (end - p >= 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb))));
+            if (mask) return p + __builtin_ctz(mask);
+            p += 32;
+        }
+#elif defined(__SSE2__)
+        const __m128i va = _mm_set1_epi8(a);
+        const __m128i vb = _mm_set1_epi8(b);
+        while (end - p >= 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+                _mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb))));
+            if (mask) return p + __builtin_ctz(mask);
+            p += 16;
+        }
+#endif
+        while (p < end && *p != a && *p != b) ++p;
+        return p;
+    }
+
+    static const char* find_newline(const char* p, const char* end) {
+        return find_either(p, end, '\n', '\n');
+    }
+
+    // Parses complete lines in [p, end) and returns where the trailing partial
+    // line starts. emit is called whenever out fills up.
+    template<typename Emit, typename Next>
+    const char* parse_lines(const char* p, const char* end, int*& out, int*& out_end,
+                            Emit& emit, Next& next) {
+        while (p < end) {
+            const char* field = p;
+            bool short_line = false;
+            for (int f = 0; f < column_; ++f) {
+                const char* sep = find_either(field, end, ',', '\n');
+                if (sep == end) return p;
+                if (*sep == '\n') {
+                    short_line = true;
+                    field = sep;
+                    break;
+                }
+                field = sep + 1;
+            }
+
+            const char* line_end;
+            if (short_line) {
+                line_end = field;
+                ++rejected_;
+            } else {
+                const char* field_end = find_either(field, end, ',', '\n');
+                if (field_end == end) return p;
+                line_end = (*field_end == '\n') ? field_end : find_newline(field_end, end);
+                if (line_end == end) return p;
+
+                uint32_t ip;
+                if (parseIPv4(field, field_end, ip)) {
+                    *out++ = static_cast<int>(ip);
+                    if (out == out_end) {
+                        emit(out_end - BATCH_ITEMS, BATCH_ITEMS);
+                        out = next();
+                        out_end = out + BATCH_ITEMS;
+                    }
+                } else {
+                    ++rejected_;
+                }
+            }
+            ++lines_;
+            p = line_end + 1;
+        }
+        return p;
+    }
+
+    template<typename Emit>
+    void parse(Emit&& emit, int* out) {
+        parse(emit, out, [&]() { return out; });
+    }
+
+    template<typename Emit, typename Next>
+    void parse(Emit&& emit, int* first, Next&& next) {
+        if (!file_) return;
+
+        int* out = first;
+        int* out_end = first + BATCH_ITEMS;
+        auto emit_partial = [&](const int* keys, size_t n) { emit(keys, n); };
+
+        char* buf = buffer_.data();
+        size_t carry = 0;
+        bool header_pending = skip_header_;
+        bool discard_line = false;
+
+        while (true) {
+            size_t got = fread(buf + carry, 1, CHUNK_BYTES, file_);
+            bytes_ += got;
+            const bool eof = got < CHUNK_BYTES;
+            size_t avail = carry + got;
+            if (eof && avail > 0 && buf[avail - 1] != '\n') {
+                buf[avail++] = '\n';
+            }
+
+            const char* p = buf;
+            const char* end = buf + avail;
+
+            if (header_pending || discard_line) {
+                const char* nl = find_newline(p, end);
+                if (nl == end) {
+                    carry = 0;
+                    discard_line = true;
+                    if (eof) break;
+                    continue;
+                }
+                p = nl + 1;
+                header_pending = false;
+                discard_line = false;
+            }
+
+            const char* rest = parse_lines(p, end, out, out_end, emit_partial, next);
+            carry = static_cast<size_t>(end - rest);
+
+            if (eof) break;
+            if (carry > CHUNK_BYTES) {
+                // A single line longer than the chunk size; drop it.
+                ++rejected_;
+                carry = 0;
+                discard_line = true;
+            } else if (carry > 0) {
+                memmove(buf, rest, carry);
+            }
+        }
+
+        const size_t pending = static_cast<size_t>(out - (out_end - BATCH_ITEMS));
+        if (pending > 0) emit(out_end - BATCH_ITEMS, pending);
+    }
+};
+
+#endif //CSVIPREADER_H
@@ -0,0 +1,82 @@
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Read-only memory mapping of a whole file. data() is nullptr when the file
+// could not be opened or is empty.
+class MappedFile {
+public:
+    explicit MappedFile(const string& path) {
+#if defined(_WIN32)
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER sz;
+        if (!GetFileSizeEx(file_, &sz) || sz.QuadPart == 0) return;
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) return;
+        void* p = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        if (!p) return;
+        data_ = static_cast<const uint8_t*>(p);
+        size_ = static_cast<size_t>(sz.QuadPart);
+#else
+        fd_ = open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) return;
+        struct stat st{};
+        if (fstat(fd_, &st) != 0 || st.st_size == 0) return;
+        void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (p == MAP_FAILED) return;
+        madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+        data_ = static_cast<const uint8_t*>(p);
+        size_ = static_cast<size_t>(st.st_size);
+#endif
+    }
+
+    ~MappedFile() {
+#if defined(_WIN32)
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+        if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+        if (fd_ >= 0) close(fd_);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] bool ok() const { return data_ != nullptr; }
+    [[nodiscard]] const uint8_t* data() const { return data_; }
+    [[nodiscard]] size_t size() const { return size_; }
+
+private:
+    const uint8_t* data_{nullptr};
+    size_t size_{0};
+#if defined(_WIN32)
+    HANDLE file_{INVALID_HANDLE_VALUE};
+    HANDLE mapping_{nullptr};
+#else
+    int fd_{-1};
+#endif
+};
+
+#endif //MAPPEDFILE_H
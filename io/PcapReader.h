@@ -0,0 +1,394 @@
+
+#ifndef PCAPREADER_H
+#define PCAPREADER_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "MappedFile.h"
+#include "../hash/MurmurHash.h"
+
+using namespace std;
+
+enum class PacketKey {
+    SrcIP,
+    DstIP,
+    FiveTuple
+};
+
+enum class PacketWeight {
+    Packets,
+    Bytes
+};
+
+// Reads classic pcap and pcapng captures through a memory mapping and turns
+// every IPv4/IPv6 packet into an (int key, uint32_t weight) pair.
+//
+// Supported link types: Ethernet (with any number of 802.1Q/802.1ad tags),
+// raw IP, BSD loopback and Linux cooked captures (SLL, SLL2). IPv4 addresses
+// are used directly as keys; IPv6 addresses and 5-tuples are folded to 32 bits
+// with MurmurHash3. Batches are delivered to a sink callable as
+// sink(const int* keys, const uint32_t* weights, size_t n), or, when the
+// weights are not wanted, as sink(const int* keys, size_t n) like
+// CsvIpReader; then no weights are produced.
+class PcapReader {
+public:
+    static constexpr size_t BATCH_ITEMS = 1u << 16;
+
+    PcapReader(const string& path, PacketKey key = PacketKey::SrcIP,
+               PacketWeight weight = PacketWeight::Packets, uint32_t seed = 0)
+        : file_(path), key_(key), weight_(weight), seed_(seed) {}
+
+    [[nodiscard]] bool ok() const { return file_.ok() && format() != Format::Unknown; }
+
+    [[nodiscard]] size_t packets() const { return packets_; }
+    [[nodiscard]] size_t skipped() const { return skipped_; }
+
+    template<typename Sink>
+    size_t run(Sink&& sink) {
+        constexpr bool weighted = !is_invocable_v<Sink&, const int*, size_t>;
+        keys_.resize(BATCH_ITEMS);
+        weights_.resize(weighted ? BATCH_ITEMS : 0);
+        fill_ = 0;
+        size_t total = 0;
+        auto flush = [&]() {
+            if (fill_ == 0) return;
+            if constexpr (weighted) {
+                sink(static_cast<const int*>(keys_.data()),
+                     static_cast<const uint32_t*>(weights_.data()), fill_);
+            } else {
+                sink(static_cast<const int*>(keys_.data()), fill_);
+            }
+            total += fill_;
+            fill_ = 0;
+        };
+
+        switch (format()) {
+            case Format::Pcap:   walk_pcap(flush); break;
+            case Format::PcapNg: walk_pcapng(flush); break;
+            default: break;
+        }
+        flush();
+        return total;
+    }
+
+private:
+    enum class Format { Unknown, Pcap, PcapNg };
+
+    static constexpr uint32_t LINKTYPE_NULL      = 0;
+    static constexpr uint32_t LINKTYPE_ETHERNET  = 1;
+    static constexpr uint32_t LINKTYPE_DLT_RAW   = 12;
+    static constexpr uint32_t LINKTYPE_RAW       = 101;
+    static constexpr uint32_t LINKTYPE_LINUX_SLL = 113;
+    static constexpr uint32_t LINKTYPE_IPV4      = 228;
+    static constexpr uint32_t LINKTYPE_IPV6      = 229;
+    static constexpr uint32_t LINKTYPE_LINUX_SLL2 = 276;
+
+    MappedFile file_;
+    PacketKey key_;
+    PacketWeight weight_;
+    uint32_t seed_;
+
+    vector<int> keys_;
+    vector<uint32_t> weights_;
+    size_t fill_{0};
+
+    size_t packets_{0};
+    size_t skipped_{0};
+
+    [[nodiscard]] Format format() const {
+        if (!file_.ok() || file_.size() < 4) return Format::Unknown;
+        uint32_t magic;
+        memcpy(&magic, file_.data(), 4);
+        switch (magic) {
+            case 0xa1b2c3d4: case 0xd4c3b2a1:
+            case 0xa1b23c4d: case 0x4d3cb2a1:
+                return Format::Pcap;
+            case 0x0a0d0d0a:
+                return Format::PcapNg;
+            default:
+                return Format::Unknown;
+        }
+    }
+
+    static uint16_t be16(const uint8_t* p) {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    static uint32_t be32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+             | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    static uint16_t rd16(const uint8_t* p, bool swap) {
+        uint16_t v;
+        memcpy(&v, p, 2);
+        return swap ? static_cast<uint16_t>((v >> 8) | (v << 8)) : v;
+    }
+
+    static uint32_t rd32(const uint8_t* p, bool swap) {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        return swap ? __builtin_bswap32(v) : v;
+    }
+
+    template<typename Flush>
+    void walk_pcap(Flush& flush) {
+        const uint8_t* base = file_.data();
+        const size_t size = file_.size();
+        if (size < 24) return;
+
+        uint32_t magic;
+        memcpy(&magic, base, 4);
+        const bool swap = (magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1);
+        const uint32_t linktype = rd32(base + 20, swap) & 0x0fffffff;
+
+        size_t off = 24;
+        while (off + 16 <= size) {
+            const uint32_t incl = rd32(base + off + 8, swap);
+            const uint32_t orig = rd32(base + off + 12, swap);
+            off += 16;
+            if (incl > size - off) break;
+            on_frame(linktype, base + off, incl, orig, flush);
+            off += incl;
+        }
+    }
+
+    template<typename Flush>
+    void walk_pcapng(Flush& flush) {
+        const uint8_t* base = file_.data();
+        const size_t size = file_.size();
+
+        bool swap = false;
+        vector<uint32_t> linktypes;
+        size_t off = 0;
+
+        while (off + 12 <= size) {
+            uint32_t type;
+            memcpy(&type, base + off, 4);
+
+            if (type == 0x0a0d0d0a) {
+                // Section header: the byte-order magic decides the section endianness.
+                uint32_t bom;
+                memcpy(&bom, base + off + 8, 4);
+                if (bom == 0x1a2b3c4d) swap = false;
+                else if (bom == 0x4d3c2b1a) swap = true;
+                else break;
+                linktypes.clear();
+            } else {
+                type = rd32(base + off, swap);
+            }
+
+            const uint32_t len = rd32(base + off + 4, swap);
+            if (len < 12 || len > size - off) break;
+            const uint8_t* body = base + off + 8;
+            const size_t body_len = len - 12;
+
+            switch (type) {
+                case 1: // interface description
+                    if (body_len >= 8) linktypes.push_back(rd16(body, swap));
+                    break;
+                case 6: // enhanced packet
+                    if (body_len >= 20) {
+                        const uint32_t iface = rd32(body, swap);
+                        const uint32_t cap   = rd32(body + 12, swap);
+                        const uint32_t orig  = rd32(body + 16, swap);
+                        if (iface < linktypes.size() && cap <= body_len - 20) {
+                            on_frame(linktypes[iface], body + 20, cap, orig, flush);
+                        } else {
+                            ++skipped_;
+                        }
+                    }
+                    break;
+                case 3: // simple packet
+                    if (body_len >= 4 && !linktypes.empty()) {
+                        const uint32_t orig = rd32(body, swap);
+                        const uint32_t cap = static_cast<uint32_t>(
+                            orig < body_len - 4 ? orig : body_len - 4);
+                        on_frame(linktypes[0], body + 4, cap, orig, flush);
+                    }
+                    break;
+                case 2: // obsolete packet block
+                    if (body_len >= 20) {
+                        const uint16_t iface = rd16(body, swap);
+                        const uint32_t cap   = rd32(body + 12, swap);
+                        const uint32_t orig  = rd32(body + 16, swap);
+                        if (iface < linktypes.size() && cap <= body_len - 20) {
+                            on_frame(linktypes[iface], body + 20, cap, orig, flush);
+                        } else {
+                            ++skipped_;
+                        }
+                    }
+                    break;
+                default:
+                    break;
+            }
+            off += len;
+        }
+    }
+
+    template<typename Flush>
+    void on_frame(uint32_t linktype, const uint8_t* p, size_t cap, uint32_t orig, Flush& flush) {
+        ++packets_;
+        const uint8_t* ip = nullptr;
+        size_t ip_len = 0;
+
+        switch (linktype) {
+            case LINKTYPE_ETHERNET: {
+                if (cap < 14) break;
+                size_t off = 12;
+                uint16_t ethertype = be16(p + off);
+                while ((ethertype == 0x8100 || ethertype == 0x88a8 || ethertype == 0x9100)
+                       && off + 6 <= cap) {
+                    off += 4;
+                    ethertype = be16(p + off);
+                }
+                off += 2;
+                if ((ethertype == 0x0800 || ethertype == 0x86dd) && off <= cap) {
+                    ip = p + off;
+                    ip_len = cap - off;
+                }
+                break;
+            }
+            case LINKTYPE_RAW:
+            case LINKTYPE_DLT_RAW:
+            case LINKTYPE_IPV4:
+            case LINKTYPE_IPV6:
+                ip = p;
+                ip_len = cap;
+                break;
+            case LINKTYPE_NULL:
+                if (cap >= 4) {
+                    ip = p + 4;
+                    ip_len = cap - 4;
+                }
+                break;
+            case LINKTYPE_LINUX_SLL:
+                if (cap >= 16) {
+                    const uint16_t proto = be16(p + 14);
+                    if (proto == 0x0800 || proto == 0x86dd) {
+                        ip = p + 16;
+                        ip_len = cap - 16;
+                    }
+                }
+                break;
+            case LINKTYPE_LINUX_SLL2:
+                if (cap >= 20) {
+                    const uint16_t proto = be16(p);
+                    if (proto == 0x0800 || proto == 0x86dd) {
+                        ip = p + 20;
+                        ip_len = cap - 20;
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+
+        int key;
+        if (ip == nullptr || !extract_key(ip, ip_len, key)) {
+            ++skipped_;
+            return;
+        }
+
+        keys_[fill_] = key;
+        if (!weights_.empty()) weights_[fill_] = (weight_ == PacketWeight::Bytes) ? orig : 1u;
+        if (++fill_ == BATCH_ITEMS) flush();
+    }
+
+    [[nodiscard]] bool extract_key(const uint8_t* ip, size_t len, int& key) const {
+        if (len < 1) return false;
+        const int version = ip[0] >> 4;
+
+        struct FlowTuple {
+            uint8_t src[16];
+            uint8_t dst[16];
+            uint16_t sport;
+            uint16_t dport;
+            uint8_t proto;
+            uint8_t pad[3];
+        } tuple{};
+
+        const uint8_t* l4 = nullptr;
+        size_t l4_len = 0;
+        bool first_fragment = true;
+
+        if (version == 4) {
+            if (len < 20) return false;
+            if (key_ == PacketKey::SrcIP) {
+                key = static_cast<int>(be32(ip + 12));
+                return true;
+            }
+            if (key_ == PacketKey::DstIP) {
+                key = static_cast<int>(be32(ip + 16));
+                return true;
+            }
+            const size_t ihl = static_cast<size_t>(ip[0] & 0x0f) * 4;
+            if (ihl < 20 || ihl > len) return false;
+            memcpy(tuple.src, ip + 12, 4);
+            memcpy(tuple.dst, ip + 16, 4);
+            tuple.proto = ip[9];
+            first_fragment = (be16(ip + 6) & 0x1fff) == 0;
+            l4 = ip + ihl;
+            l4_len = len - ihl;
+        } else if (version == 6) {
+            if (len < 40) return false;
+            if (key_ != PacketKey::FiveTuple) {
+                key = fold(ip + (key_ == PacketKey::SrcIP ? 8 : 24), 16);
+                return true;
+            }
+            memcpy(tuple.src, ip + 8, 16);
+            memcpy(tuple.dst, ip + 24, 16);
+
+            uint8_t next = ip[6];
+            size_t off = 40;
+            while (off + 8 <= len) {
+                if (next == 0 || next == 43 || next == 60) {
+                    const uint8_t nh = ip[off];
+                    off += (static_cast<size_t>(ip[off + 1]) + 1) * 8;
+                    next = nh;
+                } else if (next == 44) {
+                    first_fragment = (be16(ip + off + 2) & 0xfff8) == 0;
+                    next = ip[off];
+                    off += 8;
+                } else if (next == 51) {
+                    const uint8_t nh = ip[off];
+                    off += (static_cast<size_t>(ip[off + 1]) + 2) * 4;
+                    next = nh;
+                } else {
+                    break;
+                }
+            }
+            tuple.proto = next;
+            if (off <= len) {
+                l4 = ip + off;
+                l4_len = len - off;
+            }
+        } else {
+            return false;
+        }
+
+        const uint8_t proto = tuple.proto;
+        if (first_fragment && l4 && l4_len >= 4 && (proto == 6 || proto == 17 || proto == 132)) {
+            tuple.sport = be16(l4);
+            tuple.dport = be16(l4 + 2);
+        }
+        key = fold(&tuple, sizeof(tuple));
+        return true;
+    }
+
+    // len <= 40. Murmur reads whole words, so packet bytes are copied to an
+    // aligned buffer first.
+    [[nodiscard]] int fold(const void* bytes, int len) const {
+        uint32_t words[10];
+        memcpy(words, bytes, len);
+        uint32_t h;
+        MurmurHash3_x86_32(words, len, seed_, &h);
+        return static_cast<int>(h);
+    }
+};
+
+#endif //PCAPREADER_H
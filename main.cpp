@@ -13,16 +13,32 @@
 #include <algorithm>
 #include <numeric>
 #include <iomanip>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #include "heavy/CMSSOHH.h"
 #include "heavy/CSSOHH.h"
+#include "heavy/HHHSSSO.h"
 #include "heavy/MGSO.h"
 #include "heavy/SSSO.h"
+#include "gen/ZipfGenerator.h"
+#include "harness/ExperimentScheduler.h"
+#include "harness/GroundTruth.h"
+#include "harness/IngestPipeline.h"
+#include "harness/LatencyHistogram.h"
+#include "harness/PerfCounters.h"
+#include "io/CsvIpReader.h"
+#include "io/PcapReader.h"
 
 using namespace std;
 
 static constexpr int NUM_REPEATS = 20;
 
+// One update in every 2^LATENCY_SAMPLE_SHIFT is timed individually for the
+// latency histogram; the rest run untimed to keep the overhead low.
+static constexpr int LATENCY_SAMPLE_SHIFT = 6;
+
 struct AggStats {
     double mean;
     double p5;
@@ -54,27 +70,20 @@ std::vector<int> parseIp(const std::string& ip) {
     return result;
 }
 
-vector<int> generateRandomItems(int length, int min_val, int max_val, double skew) {
-    random_device rd;
-    mt19937 gen(rd());
-    vector<double> probabilities(max_val - min_val + 1);
-    double sum = 0.0;
-
-    for (int i = 0; i < probabilities.size(); ++i) {
-        probabilities[i] = 1.0 / pow(i + 1, skew);
-        sum += probabilities[i];
-    }
-
-    for (double &p : probabilities) {
-        p /= sum;
-    }
+// Seed of sub-experiment (a, b) of an experiment seeded with `seed`: a
+// splitmix64 finaliser, so nearby indices give unrelated seeds.
+uint64_t deriveSeed(uint64_t seed, uint64_t a, uint64_t b = 0) {
+    uint64_t z = seed + 0x9e3779b97f4a7c15ull * (a + 1) + 0xc2b2ae3d27d4eb4full * (b + 1);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
 
-    discrete_distribution<int> dis(probabilities.begin(), probabilities.end());
-    vector<int> items;
-    for (int i = 0; i < length; ++i) {
-        items.push_back(min_val + dis(gen));
-    }
-    return items;
+vector<int> generateRandomItems(int length, int min_val, int max_val, double skew,
+                                uint64_t seed) {
+    ZipfOptions opts;
+    opts.seed = seed;
+    return ZipfGenerator(min_val, max_val, skew).generate(static_cast<size_t>(length), opts);
 }
 
 struct HHTestResult {
@@ -82,38 +91,70 @@ struct HHTestResult {
     double ARE;
     double precision;
     double recall;
+    PerfSample ingest;  // per item
+    PerfSample query;   // per query() call
+    LatencyHistogram latency;
+    double memoryBytes;    // after ingest
+    double bytesPerKey;    // memoryBytes / tracked_keys()
 };
 
-HHTestResult testHH(SketchHH& algo, const vector<int>& stream, int k) {
-    unordered_map<int, int> exact_counts;
+// Mean over the values that are not NaN (counters missing on this host).
+double meanIgnoringNaN(const std::vector<double>& v) {
+    double sum = 0.0;
+    size_t n = 0;
+    for (double x : v) {
+        if (!std::isnan(x)) {
+            sum += x;
+            ++n;
+        }
+    }
+    return n ? sum / n : std::nan("");
+}
+
+HHTestResult testHH(SketchHH& algo, const vector<int>& stream, int k,
+                    const GroundTruth& truth) {
+    LatencyHistogram latency;
+    const size_t n = stream.size();
+    const size_t block = size_t{1} << LATENCY_SAMPLE_SHIFT;
+
+    PerfCounters counters;
+    counters.start();
     auto start = chrono::high_resolution_clock::now();
 
-    for (int item : stream) {
-        exact_counts[item]++;
-        algo.update(item);
+    for (size_t i = 0; i < n; i += block) {
+        const uint64_t t0 = LatencyHistogram::now();
+        algo.update(stream[i]);
+        latency.record(LatencyHistogram::now() - t0);
+
+        const size_t block_end = min(n, i + block);
+        for (size_t j = i + 1; j < block_end; ++j) {
+            algo.update(stream[j]);
+        }
     }
 
     auto end = chrono::high_resolution_clock::now();
+    PerfSample ingest = counters.stop();
     chrono::duration<double, std::micro> duration = end - start;
     double update_time_per_item = duration.count() / stream.size();
 
-    // Compute threshold F_1 / k
-    int F1 = 0;
-    for (const auto& pair : exact_counts) {
-        F1 += pair.second;
-    }
-    double hh_threshold = static_cast<double>(F1) / k;
+    const auto n_items = static_cast<double>(stream.size());
+    ingest.cycles        /= n_items;
+    ingest.instructions  /= n_items;
+    ingest.llc_misses    /= n_items;
+    ingest.branch_misses /= n_items;
+    ingest.dtlb_misses   /= n_items;
 
-    // True heavy hitters
-    unordered_map<int, int> true_hh;
-    for (const auto& pair : exact_counts) {
-        if (pair.second >= hh_threshold) {
-            true_hh[pair.first] = pair.second;
-        }
-    }
+    const auto memory_bytes = static_cast<double>(algo.memory_bytes());
+    const size_t tracked = algo.tracked_keys();
+    const double bytes_per_key = tracked ? memory_bytes / static_cast<double>(tracked) : 0.0;
+
+    // True heavy hitters (count >= F_1 / k), cached per stream and k
+    const vector<int>& true_hh = truth.heavyHitters(k);
 
     // Retrieved heavy hitters
+    counters.start();
     const auto& reported = algo.query();
+    PerfSample query = counters.stop();
 
     // Track ARE and coverage
     double total_relative_error = 0.0;
@@ -127,15 +168,14 @@ HHTestResult testHH(SketchHH& algo, const vector<int>& stream, int k) {
         int item = pair.first;
         double est_freq = pair.second;
 
-        auto it = exact_counts.find(item);
-        if (it != exact_counts.end()) {
-            double exact_freq = it->second;
+        int exact_freq = truth.count(item);
+        if (exact_freq > 0) {
             total_relative_error += abs(est_freq - exact_freq) / exact_freq;
         }
     }
 
-    for (const auto& hh : true_hh) {
-        if (reported_ids.count(hh.first)) {
+    for (int hh : true_hh) {
+        if (reported_ids.count(hh)) {
             matched++;
         }
     }
@@ -144,42 +184,26 @@ HHTestResult testHH(SketchHH& algo, const vector<int>& stream, int k) {
     double recall = true_hh.empty() ? 1.0 : static_cast<double>(matched) / true_hh.size();
     double precision = reported.empty() ? 1.0 : static_cast<double>(matched) / reported.size();
 
-    return {update_time_per_item, ARE, precision, recall};
+    return {update_time_per_item, ARE, precision, recall, ingest, query, latency,
+            memory_bytes, bytes_per_key};
 }
 
 bool ipStringToInt(const std::string& input, int& output) {
-    // Remove quotes
-    std::string s = input;
-    if (!s.empty() && s.front() == '"' && s.back() == '"') {
-        s = s.substr(1, s.size() - 2);
-    }
-
-    // Quick heuristic: IPv4 must have 3 dots
-    if (std::count(s.begin(), s.end(), '.') != 3) {
+    uint32_t ip;
+    if (!parseIPv4(input.data(), input.data() + input.size(), ip)) {
         return false;  // Not IPv4, ignore
     }
-
-    std::istringstream ss(s);
-    std::string token;
-    uint32_t result = 0;
-
-    for (int i = 0; i < 4; ++i) {
-        if (!std::getline(ss, token, '.')) {
-            return false;  // invalid format
-        }
-        try {
-            int part = std::stoi(token);
-            if (part < 0 || part > 255) return false;  // invalid octet
-            result = (result << 8) | part;
-        } catch (...) {
-            return false;  // stoi failed -> ignore
-        }
-    }
-
-    output = result;
+    output = static_cast<int>(ip);
     return true;
 }
 
+bool isPcapPath(const std::string& path) {
+    auto ends_with = [&](const std::string& suffix) {
+        return path.size() >= suffix.size()
+            && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    return ends_with(".pcap") || ends_with(".pcapng") || ends_with(".cap");
+}
 
 static constexpr size_t DEFAULT_STREAM_LENGTH = (1u << 24);
 static constexpr int DEFAULT_MIN_VAL = 0;
@@ -198,107 +222,408 @@ static constexpr double DEFAULT_DELTA = 0.001;
 static constexpr int    DEFAULT_DEPTH = 32;
 static constexpr uint32_t DEFAULT_SEED = 42;
 
-void runHHAlgorithmsAgg(std::ofstream& ofs,
+// Seed of a whole run (--seed); every generated stream derives its own.
+static constexpr uint64_t DEFAULT_EXPERIMENT_SEED = 42;
+
+// Stream generation seeds: one per sweep and grid point.
+enum StreamSweep : uint64_t { SWEEP_K, SWEEP_EPS, SWEEP_SKEW, SWEEP_SAMPLING };
+
+// Buckets of the heavy/light front end (64 bytes each, L1-resident).
+static constexpr size_t FRONT_BUCKETS = 256;
+
+// Base counter width of the compact sketch tables ("+C16" engines).
+static constexpr int COUNTER_BITS = 16;
+
+// Packet sampling rates for the throughput/recall curve.
+static const std::vector<double> SAMPLE_RATE_GRID = {1.0, 0.5, 0.25, 0.1, 0.05, 0.01};
+
+static constexpr int CAIDA_SOURCE_COLUMN = 2;
+
+// Engines of one configuration that finished a repeat, kept per worker
+// thread for that worker's next repeat to reset() instead of building a new
+// one. An engine never moves between workers: its tables were first touched
+// by, and sit in the caches and NUMA node of, the worker that built it.
+template<typename Algo>
+struct EngineShelf {
+    std::mutex m;
+    std::unordered_map<std::thread::id, Algo> spare;
+
+    Algo take() {
+        std::lock_guard<std::mutex> lock(m);
+        auto it = spare.find(std::this_thread::get_id());
+        if (it == spare.end()) return nullptr;
+        Algo a = std::move(it->second);
+        spare.erase(it);
+        return a;
+    }
+
+    void put(Algo a) {
+        std::lock_guard<std::mutex> lock(m);
+        spare[std::this_thread::get_id()] = std::move(a);
+    }
+};
+
+// Seed of one engine configuration: the experiment seed mixed with the
+// configuration's name and parameters, so it does not depend on the order in
+// which configurations are submitted or scheduled.
+uint64_t configSeed(uint64_t seed, const std::string& name, int k, size_t tilde_k,
+                    double eps, double skew) {
+    std::ostringstream key;
+    key << name << '/' << k << '/' << tilde_k << '/' << eps << '/' << skew;
+    const std::string bytes = key.str();
+    uint32_t h;
+    MurmurHash3_x86_32(bytes.data(), static_cast<int>(bytes.size()), 0, &h);
+    return deriveSeed(seed, h);
+}
+
+// Runs NUM_REPEATS repeats of one engine configuration on the scheduler and
+// writes the aggregated CSV row and console line once they have finished.
+// Repeat r runs with seed s = deriveSeed(config seed, r), so hash seeds do
+// not depend on --jobs. Only the first repeat on each worker builds an
+// engine, with make_algo(s); later ones reset a finished one with s. seeded: the engine uses its seed (the CSV then records the
+// configuration seed, else 0).
+template<typename MakeAlgo>
+void runAndAggregate(ExperimentScheduler& sched,
+                     std::ofstream& ofs,
+                     const std::vector<int>& stream,
+                     const GroundTruth& truth,
+                     int k,
+                     double eps,
+                     double skew,
+                     size_t stream_length,
+                     uint64_t experiment_seed,
+                     const std::string& name,
+                     MakeAlgo make_algo,
+                     size_t tilde_k_local,
+                     double delta,
+                     int depth,
+                     bool seeded)
+{
+    const std::vector<int>* stream_ptr = &stream;
+    const GroundTruth* truth_ptr = &truth;
+    std::ofstream* ofs_ptr = &ofs;
+    const uint64_t config_seed = configSeed(experiment_seed, name, k, tilde_k_local, eps, skew);
+    const uint64_t seed = seeded ? config_seed : 0;
+
+    auto shelf = std::make_shared<EngineShelf<decltype(make_algo(uint64_t{0}))>>();
+
+    sched.submit<HHTestResult>(
+        NUM_REPEATS,
+        [make_algo, stream_ptr, truth_ptr, k, shelf, config_seed](size_t r) {
+            const uint64_t repeat_seed = deriveSeed(config_seed, r);
+            auto algo = shelf->take();
+            if (algo) algo->reset(static_cast<uint32_t>(repeat_seed));
+            else algo = make_algo(repeat_seed);
+            HHTestResult res = testHH(*algo, *stream_ptr, k, *truth_ptr);
+            shelf->put(std::move(algo));
+            return res;
+        },
+        [=](std::vector<HHTestResult>& results) {
+            std::vector<double> times, are, prec, rec;
+            std::vector<double> cyc, ins, llc, br, tlb, qcyc, mem, bpk;
+            LatencyHistogram latency;
+            for (const HHTestResult& res : results) {
+                latency.merge(res.latency);
+                times.push_back(res.updateTime);
+                are.push_back(res.ARE);
+                prec.push_back(res.precision);
+                rec.push_back(res.recall);
+                cyc.push_back(res.ingest.cycles);
+                ins.push_back(res.ingest.instructions);
+                llc.push_back(res.ingest.llc_misses);
+                br.push_back(res.ingest.branch_misses);
+                tlb.push_back(res.ingest.dtlb_misses);
+                qcyc.push_back(res.query.cycles);
+                mem.push_back(res.memoryBytes);
+                bpk.push_back(res.bytesPerKey);
+            }
+
+            auto t = computeStats(times);
+            auto a = computeStats(are);
+            auto p = computeStats(prec);
+            auto r = computeStats(rec);
+
+            std::ofstream& out = *ofs_ptr;
+            out << name << "," << k << "," << tilde_k_local << ","
+                << eps << "," << delta << ","
+                << depth << "," << seed << ","
+                << skew << "," << stream_length << ","
+                << std::fixed << std::setprecision(6)
+                << t.mean << "," << t.p5 << "," << t.p95 << ","
+                << meanIgnoringNaN(cyc) << "," << meanIgnoringNaN(ins) << ","
+                << meanIgnoringNaN(llc) << "," << meanIgnoringNaN(br) << ","
+                << meanIgnoringNaN(tlb) << "," << meanIgnoringNaN(qcyc) << ","
+                << latency.percentileNs(0.5) << "," << latency.percentileNs(0.99) << ","
+                << latency.percentileNs(0.999) << "," << latency.maxNs() << ","
+                << meanIgnoringNaN(mem) << "," << meanIgnoringNaN(bpk) << ","
+                << a.mean << "," << a.p5 << "," << a.p95 << ","
+                << p.mean << "," << p.p5 << "," << p.p95 << ","
+                << r.mean << "," << r.p5 << "," << r.p95 << "\n";
+
+            std::cout << name << " | k=" << k
+                      << " eps=" << eps
+                      << " skew=" << skew
+                      << " | update(us/item)=" << t.mean
+                      << " update(5th)=" << t.p5
+                        << " update(95th)=" << t.p95
+                      << " | cyc/item=" << meanIgnoringNaN(cyc)
+                      << " LLC/item=" << meanIgnoringNaN(llc)
+                      << " | lat(ns) p50=" << latency.percentileNs(0.5)
+                      << " p99=" << latency.percentileNs(0.99)
+                      << " p99.9=" << latency.percentileNs(0.999)
+                      << " max=" << latency.maxNs()
+                      << " | bytes=" << meanIgnoringNaN(mem)
+                      << " | ARE=" << a.mean
+                      << " P=" << p.mean
+                      << " R=" << r.mean << std::endl;
+        });
+}
+
+void runHHAlgorithmsAgg(ExperimentScheduler& sched,
+                        std::ofstream& ofs,
                         const std::vector<int>& stream,
+                        const GroundTruth& truth,
                         int k,
                         size_t tilde_k,
                         double eps,
                         double skew,
-                        size_t stream_length)
+                        size_t stream_length,
+                        uint64_t seed,
+                        bool hierarchical = false)
 {
     auto run_and_aggregate =
         [&](const std::string& name,
-            auto&& make_algo,
+            auto make_algo,
             size_t tilde_k_local,
             double delta,
             int depth,
-            int seed)
+            bool seeded)
     {
-        std::vector<double> times, are, prec, rec;
-
-        for (int r = 0; r < NUM_REPEATS; ++r) {
-            auto algo = make_algo();
-            HHTestResult res = testHH(*algo, stream, k);
-
-            times.push_back(res.updateTime);
-            are.push_back(res.ARE);
-            prec.push_back(res.precision);
-            rec.push_back(res.recall);
-        }
-
-        auto t = computeStats(times);
-        auto a = computeStats(are);
-        auto p = computeStats(prec);
-        auto r = computeStats(rec);
-
-        ofs << name << "," << k << "," << tilde_k_local << ","
-            << eps << "," << delta << ","
-            << depth << "," << seed << ","
-            << skew << "," << stream_length << ","
-            << std::fixed << std::setprecision(6)
-            << t.mean << "," << t.p5 << "," << t.p95 << ","
-            << a.mean << "," << a.p5 << "," << a.p95 << ","
-            << p.mean << "," << p.p5 << "," << p.p95 << ","
-            << r.mean << "," << r.p5 << "," << r.p95 << "\n";
-
-        std::cout << name << " | k=" << k
-                  << " eps=" << eps
-                  << " skew=" << skew
-                  << " | update(us/item)=" << t.mean
-                  << " update(5th)=" << t.p5
-                    << " update(95th)=" << t.p95
-                  << " | ARE=" << a.mean
-                  << " P=" << p.mean
-                  << " R=" << r.mean << std::endl;
+        runAndAggregate(sched, ofs, stream, truth, k, eps, skew, stream_length, seed,
+                        name, make_algo, tilde_k_local, delta, depth, seeded);
     };
 
 
     // -------- MGSO --------
     run_and_aggregate(
         "MGSO",
-        [&]() {
+        [=](uint64_t) {
             return std::make_unique<MGSO>(k, tilde_k, eps, DEFAULT_DELTA);
         },
-        0, DEFAULT_DELTA, 0, 0
+        0, DEFAULT_DELTA, 0, false
     );
 
     // -------- SSSO --------
     run_and_aggregate(
         "SSSO",
-        [&]() {
+        [=](uint64_t) {
             return std::make_unique<SSSO>(k, tilde_k, eps, DEFAULT_DELTA);
         },
-        tilde_k, DEFAULT_DELTA, 0, 0
+        tilde_k, DEFAULT_DELTA, 0, false
     );
 
     // -------- CMSSOHH --------
     run_and_aggregate(
         "CMSSOHH",
-        [&]() {
-            int seed = rand();
+        [=](uint64_t seed) {
             return std::make_unique<CMSSOHH>(
                 DEFAULT_DEPTH, eps, DEFAULT_DELTA,
-                k, 2*tilde_k, seed, stream_length
+                k, 2*tilde_k, static_cast<uint32_t>(seed), stream_length
             );
         },
-        tilde_k, 0.0, DEFAULT_DEPTH, DEFAULT_SEED
+        tilde_k, 0.0, DEFAULT_DEPTH, true
     );
 
     // -------- CSSOHH --------
     run_and_aggregate(
         "CSSOHH",
-        [&]() {
+        [=](uint64_t seed) {
+            return std::make_unique<CSSOHH>(
+                DEFAULT_DEPTH, eps, DEFAULT_DELTA,
+                k, 2*tilde_k, static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32), stream_length
+            );
+        },
+        tilde_k, 0.0, DEFAULT_DEPTH, true
+    );
+
+    // -------- CMSSOHH / CSSOHH with heavy/light front end --------
+    run_and_aggregate(
+        "CMSSOHH+EF",
+        [=](uint64_t seed) {
+            return std::make_unique<CMSSOHH>(
+                DEFAULT_DEPTH, eps, DEFAULT_DELTA,
+                k, 2*tilde_k, static_cast<uint32_t>(seed), stream_length, FRONT_BUCKETS
+            );
+        },
+        tilde_k, 0.0, DEFAULT_DEPTH, true
+    );
+
+    run_and_aggregate(
+        "CSSOHH+EF",
+        [=](uint64_t seed) {
             return std::make_unique<CSSOHH>(
                 DEFAULT_DEPTH, eps, DEFAULT_DELTA,
-                k, 2*tilde_k, rand(), rand(), stream_length
+                k, 2*tilde_k, static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32), stream_length, FRONT_BUCKETS
+            );
+        },
+        tilde_k, 0.0, DEFAULT_DEPTH, true
+    );
+
+    // -------- CMSSOHH / CSSOHH with compact counters --------
+    run_and_aggregate(
+        "CMSSOHH+C16",
+        [=](uint64_t seed) {
+            return std::make_unique<CMSSOHH>(
+                DEFAULT_DEPTH, eps, DEFAULT_DELTA,
+                k, 2*tilde_k, static_cast<uint32_t>(seed), stream_length, 0, 1.0,
+                CandidatePolicy::Auto, COUNTER_BITS
             );
         },
-        tilde_k, 0.0, DEFAULT_DEPTH, DEFAULT_SEED
+        tilde_k, 0.0, DEFAULT_DEPTH, true
     );
 
+    run_and_aggregate(
+        "CSSOHH+C16",
+        [=](uint64_t seed) {
+            return std::make_unique<CSSOHH>(
+                DEFAULT_DEPTH, eps, DEFAULT_DELTA,
+                k, 2*tilde_k, static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32), stream_length, 0, 1.0,
+                CandidatePolicy::Auto, COUNTER_BITS
+            );
+        },
+        tilde_k, 0.0, DEFAULT_DEPTH, true
+    );
+
+    // -------- HHHSSSO (IPv4 streams only) --------
+    if (hierarchical) {
+        run_and_aggregate(
+            "HHHSSSO",
+            [=](uint64_t) {
+                return std::make_unique<HHHSSSO>(k, tilde_k, eps, DEFAULT_DELTA);
+            },
+            tilde_k, DEFAULT_DELTA, 0, false
+        );
+    }
+
+}
+
+// Sampled CMSSOHH and CSSOHH, one configuration per rate p, for the
+// throughput/recall curve. The rate is part of the algo name.
+void runSamplingSweepAgg(ExperimentScheduler& sched,
+                         std::ofstream& ofs,
+                         const std::vector<int>& stream,
+                         const GroundTruth& truth,
+                         int k,
+                         size_t tilde_k,
+                         double eps,
+                         double skew,
+                         size_t stream_length,
+                         uint64_t seed)
+{
+    for (double p : SAMPLE_RATE_GRID) {
+        std::ostringstream rate;
+        rate << "/p=" << p;
+
+        runAndAggregate(sched, ofs, stream, truth, k, eps, skew, stream_length, seed,
+            "CMSSOHH" + rate.str(),
+            [=](uint64_t seed) {
+                return std::make_unique<CMSSOHH>(
+                    DEFAULT_DEPTH, eps, DEFAULT_DELTA,
+                    k, 2*tilde_k, static_cast<uint32_t>(seed), stream_length, 0, p
+                );
+            },
+            tilde_k, 0.0, DEFAULT_DEPTH, true);
+
+        runAndAggregate(sched, ofs, stream, truth, k, eps, skew, stream_length, seed,
+            "CSSOHH" + rate.str(),
+            [=](uint64_t seed) {
+                return std::make_unique<CSSOHH>(
+                    DEFAULT_DEPTH, eps, DEFAULT_DELTA,
+                    k, 2*tilde_k, static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32), stream_length, 0, p
+                );
+            },
+            tilde_k, 0.0, DEFAULT_DEPTH, true);
+    }
+}
+
+struct HHHTestResult {
+    double singlePassTime;
+    double perLevelTime;
+    double reported;
+};
+
+// Hierarchical heavy hitters over /8, /16, /24, /32: one HHHSSSO pass against
+// one SSSO per prefix length, each run as its own pass over the stream with
+// the same eps/L, delta/L share. Times are us per stream item, summed over
+// the per-level passes.
+void runHHHComparisonAgg(ExperimentScheduler& sched,
+                         std::ofstream& ofs,
+                         const std::vector<int>& stream,
+                         int k,
+                         size_t tilde_k,
+                         double eps,
+                         size_t stream_length)
+{
+    const std::vector<int> lengths = {8, 16, 24, 32};
+    const std::vector<int>* stream_ptr = &stream;
+    std::ofstream* ofs_ptr = &ofs;
+
+    sched.submit<HHHTestResult>(
+        NUM_REPEATS,
+        [=](size_t) {
+            const std::vector<int>& s = *stream_ptr;
+            const auto n_items = static_cast<double>(s.size());
+
+            HHHSSSO hhh(k, tilde_k, eps, DEFAULT_DELTA, lengths);
+            auto start = chrono::high_resolution_clock::now();
+            for (int item : s) hhh.update(item);
+            auto end = chrono::high_resolution_clock::now();
+            const double single = chrono::duration<double, std::micro>(end - start).count() / n_items;
+            const double reported = static_cast<double>(hhh.query_hierarchical().size());
+
+            const double L = static_cast<double>(lengths.size());
+            double per_level = 0.0;
+            for (int len : lengths) {
+                const uint32_t mask = ~0u << (32 - len);
+                SSSO level(k, tilde_k, eps / L, DEFAULT_DELTA / L);
+                start = chrono::high_resolution_clock::now();
+                for (int item : s) level.update(static_cast<int>(static_cast<uint32_t>(item) & mask));
+                end = chrono::high_resolution_clock::now();
+                per_level += chrono::duration<double, std::micro>(end - start).count() / n_items;
+            }
+            return HHHTestResult{single, per_level, reported};
+        },
+        [=](std::vector<HHHTestResult>& results) {
+            std::vector<double> single, per_level, reported;
+            for (const HHHTestResult& res : results) {
+                single.push_back(res.singlePassTime);
+                per_level.push_back(res.perLevelTime);
+                reported.push_back(res.reported);
+            }
+            auto s = computeStats(single);
+            auto l = computeStats(per_level);
+            auto r = computeStats(reported);
+
+            std::ofstream& out = *ofs_ptr;
+            out << k << "," << tilde_k << "," << eps << ","
+                << lengths.size() << "," << stream_length << ","
+                << std::fixed << std::setprecision(6)
+                << s.mean << "," << s.p5 << "," << s.p95 << ","
+                << l.mean << "," << l.p5 << "," << l.p95 << ","
+                << l.mean / s.mean << "," << r.mean << "\n";
+
+            std::cout << "HHHSSSO vs SSSO/level | k=" << k
+                      << " eps=" << eps
+                      << " | single(us/item)=" << s.mean
+                      << " per-level(us/item)=" << l.mean
+                      << " speedup=" << l.mean / s.mean
+                      << " | prefixes=" << r.mean << std::endl;
+        });
 }
 
 void runHHExperiments(
+    ExperimentScheduler& sched,
+    uint64_t seed = DEFAULT_EXPERIMENT_SEED,
     size_t stream_length = DEFAULT_STREAM_LENGTH,
     int min_val = DEFAULT_MIN_VAL,
     int max_val = DEFAULT_MAX_VAL,
@@ -318,6 +643,10 @@ void runHHExperiments(
 
     ofs << "algo,k,tilde_k,eps,delta,depth,seed,skew,stream_len,"
        "update_mean,update_p5,update_p95,"
+       "cycles_per_item,instr_per_item,llc_miss_per_item,"
+       "branch_miss_per_item,dtlb_miss_per_item,query_cycles,"
+       "latency_p50_ns,latency_p99_ns,latency_p999_ns,latency_max_ns,"
+       "memory_bytes,bytes_per_key,"
        "ARE_mean,ARE_p5,ARE_p95,"
        "precision_mean,precision_p5,precision_p95,"
        "recall_mean,recall_p5,recall_p95\n";
@@ -340,14 +669,16 @@ void runHHExperiments(
         std::vector<int> stream = generateRandomItems(
             static_cast<int>(stream_length),
             min_val, max_val,
-            skew
+            skew, deriveSeed(seed, SWEEP_K)
         );
+        const GroundTruth truth(stream);
 
         for (int k : k_grid) {
             auto tilde_k = static_cast<size_t>(k*TILDE_K_FACTOR);
-            runHHAlgorithmsAgg(ofs, stream, k, tilde_k, eps, skew, stream_length);
+            runHHAlgorithmsAgg(sched, ofs, stream, truth, k, tilde_k, eps, skew, stream_length, seed);
         }
 
+        sched.drain();
         std::cout << "[INFO] Completed k-sweep.\n\n";
     }
 
@@ -361,15 +692,17 @@ void runHHExperiments(
         std::vector<int> stream = generateRandomItems(
             static_cast<int>(stream_length),
             min_val, max_val,
-            skew
+            skew, deriveSeed(seed, SWEEP_EPS)
         );
+        const GroundTruth truth(stream);
 
         for (double eps : eps_grid) {
             auto tilde_k = static_cast<size_t>(DEFAULT_K*TILDE_K_FACTOR);
-            runHHAlgorithmsAgg(ofs, stream, DEFAULT_K, tilde_k, eps,
-                                         DEFAULT_SKEW, stream_length);
+            runHHAlgorithmsAgg(sched, ofs, stream, truth, DEFAULT_K, tilde_k, eps,
+                                         DEFAULT_SKEW, stream_length, seed);
         } // eps
 
+        sched.drain();
         std::cout << "[INFO] Completed eps-sweep.\n\n";
     }
 
@@ -380,26 +713,52 @@ void runHHExperiments(
         const int    k   = DEFAULT_K;
         const double eps = DEFAULT_EPS;
 
-        for (double skew : skew_grid) {
+        for (size_t i = 0; i < skew_grid.size(); ++i) {
+            const double skew = skew_grid[i];
             std::vector<int> stream = generateRandomItems(
                 static_cast<int>(stream_length),
                 min_val, max_val,
-                skew
+                skew, deriveSeed(seed, SWEEP_SKEW, i)
             );
+            const GroundTruth truth(stream);
             auto tilde_k = static_cast<size_t>(DEFAULT_K*TILDE_K_FACTOR);
-            runHHAlgorithmsAgg(ofs, stream, DEFAULT_K, tilde_k, DEFAULT_EPS,
-                                         skew, stream_length);
+            runHHAlgorithmsAgg(sched, ofs, stream, truth, DEFAULT_K, tilde_k, DEFAULT_EPS,
+                                         skew, stream_length, seed);
+            sched.drain();
         }
     }
 
+    // ============================================================
+    // 4) Sweep over sample rate p: k = DEFAULT_K, eps = DEFAULT_EPS
+    // ============================================================
+    {
+        const double skew = DEFAULT_SKEW;
+
+        std::vector<int> stream = generateRandomItems(
+            static_cast<int>(stream_length),
+            min_val, max_val,
+            skew, deriveSeed(seed, SWEEP_SAMPLING)
+        );
+        const GroundTruth truth(stream);
+        auto tilde_k = static_cast<size_t>(DEFAULT_K*TILDE_K_FACTOR);
+        runSamplingSweepAgg(sched, ofs, stream, truth, DEFAULT_K, tilde_k, DEFAULT_EPS,
+                            skew, stream_length, seed);
+
+        sched.drain();
+        std::cout << "[INFO] Completed sample-rate sweep.\n\n";
+    }
+
     ofs.close();
     std::cout << "\n[DONE] Results written to: " << out_csv << std::endl;
 }
 
 void runHHExperimentsCaida(
+    ExperimentScheduler& sched,
+    uint64_t seed = DEFAULT_EXPERIMENT_SEED,
     const std::string& caida_csv =
         "C:/Users/HOL446/CLionProjects/CODPSketches/data/packet_capture.csv",
-    const std::string& out_csv = "hh_experiments_caida.csv"
+    const std::string& out_csv = "hh_experiments_caida.csv",
+    const std::string& hhh_csv = "hhh_experiments_caida.csv"
 ) {
     // Parameter grids (same as synthetic experiments)
     const std::vector<int>    k_grid   = {128, 256, 512, 1024, 2048, 4096};
@@ -407,50 +766,41 @@ void runHHExperimentsCaida(
     const std::vector<int> k_tilde_factor_grid = {1,2,4,8,16};
 
     // ------------------------------------------------------------
-    // Load CAIDA stream (source IPs)
+    // Load CAIDA stream (source IPs) from a CSV export or a raw capture
     // ------------------------------------------------------------
-    std::ifstream file(caida_csv);
-    if (!file) {
-        std::cerr << "[ERROR] Could not open CAIDA file: "
-                  << caida_csv << std::endl;
-        return;
-    }
-
-    std::string line;
-    std::getline(file, line); // skip header
-
     std::vector<int> stream;
-    std::unordered_set<int> unique_ips;
-
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        std::string field;
-        int fieldIndex = 0;
-        std::string sourceIP;
-
-        while (std::getline(ss, field, ',')) {
-            if (fieldIndex == 2) { // Source IP column
-                sourceIP = field;
-                break;
-            }
-            ++fieldIndex;
-        }
 
-        int ipInt;
-        if (ipStringToInt(sourceIP, ipInt)) {
-            ipInt = abs(ipInt);
+    auto collect = [&](const int* keys, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            int ipInt = abs(keys[i]);
             stream.push_back(ipInt);
-            unique_ips.insert(ipInt);
         }
-    }
+    };
 
-    file.close();
+    if (isPcapPath(caida_csv)) {
+        PcapReader reader(caida_csv, PacketKey::SrcIP);
+        if (!reader.ok()) {
+            std::cerr << "[ERROR] Could not open CAIDA capture: "
+                      << caida_csv << std::endl;
+            return;
+        }
+        reader.run(collect);
+    } else {
+        CsvIpReader reader(caida_csv, CAIDA_SOURCE_COLUMN);
+        if (!reader.ok()) {
+            std::cerr << "[ERROR] Could not open CAIDA file: "
+                      << caida_csv << std::endl;
+            return;
+        }
+        reader.run_async(collect);
+    }
 
     const size_t stream_length = stream.size();
+    const GroundTruth truth(stream);
 
     std::cout << "=== CAIDA Heavy-Hitter Experiments ===\n"
               << "Stream length: " << stream_length << "\n"
-              << "Distinct IPs:  " << unique_ips.size() << "\n"
+              << "Distinct IPs:  " << truth.distinct() << "\n"
               << "Skew: REAL (fixed)\n\n";
 
     // ------------------------------------------------------------
@@ -465,6 +815,10 @@ void runHHExperimentsCaida(
 
     ofs << "algo,k,tilde_k,eps,delta,depth,seed,skew,stream_len,"
            "update_mean,update_p5,update_p95,"
+           "cycles_per_item,instr_per_item,llc_miss_per_item,"
+           "branch_miss_per_item,dtlb_miss_per_item,query_cycles,"
+           "latency_p50_ns,latency_p99_ns,latency_p999_ns,latency_max_ns,"
+       "memory_bytes,bytes_per_key,"
            "ARE_mean,ARE_p5,ARE_p95,"
            "precision_mean,precision_p5,precision_p95,"
            "recall_mean,recall_p5,recall_p95\n";
@@ -479,16 +833,21 @@ void runHHExperimentsCaida(
         for (int k : k_grid) {
             auto tilde_k = static_cast<size_t>(k*TILDE_K_FACTOR);
             runHHAlgorithmsAgg(
+                sched,
                 ofs,
                 stream,
+                truth,
                 k,
                 tilde_k,
                 eps,
                 skew,
-                stream_length
+                stream_length,
+                seed,
+                /*hierarchical=*/true
             );
         }
 
+        sched.drain();
         std::cout << "[INFO] Completed k-sweep (CAIDA).\n\n";
     }
 
@@ -502,16 +861,21 @@ void runHHExperimentsCaida(
         for (double eps : eps_grid) {
             auto tilde_k = static_cast<size_t>(DEFAULT_K*TILDE_K_FACTOR);
             runHHAlgorithmsAgg(
+                sched,
                 ofs,
                 stream,
+                truth,
                 k,
                 tilde_k,
                 eps,
                 skew,
-                stream_length
+                stream_length,
+                seed,
+                /*hierarchical=*/true
             );
         }
 
+        sched.drain();
         std::cout << "[INFO] Completed eps-sweep (CAIDA).\n\n";
     }
 
@@ -526,31 +890,178 @@ void runHHExperimentsCaida(
         for (int factor : k_tilde_factor_grid) {
             size_t tilde_k = (factor*k);
             runHHAlgorithmsAgg(
+                sched,
                 ofs,
                 stream,
+                truth,
                 k,
                 tilde_k,
                 eps,
                 skew,
-                stream_length
+                stream_length,
+                seed,
+                /*hierarchical=*/true
             );
         }
 
+        sched.drain();
         std::cout << "[INFO] Completed eps-sweep (CAIDA).\n\n";
     }
 
+    // ============================================================
+    // 4) Sweep over sample rate p (k, eps fixed)
+    // ============================================================
+    {
+        const int    k    = DEFAULT_K_CAIDA;
+        const double skew = 0.0; // real stream
+
+        auto tilde_k = static_cast<size_t>(k*TILDE_K_FACTOR);
+        runSamplingSweepAgg(sched, ofs, stream, truth, k, tilde_k, DEFAULT_EPS,
+                            skew, stream_length, seed);
+
+        sched.drain();
+        std::cout << "[INFO] Completed sample-rate sweep (CAIDA).\n\n";
+    }
+
     ofs.close();
     std::cout << "[DONE] CAIDA results written to: "
               << out_csv << std::endl;
-}
 
-int main() {
+    // ============================================================
+    // 5) Hierarchical heavy hitters: single pass vs one pass per level
+    // ============================================================
+    std::ofstream hhh_ofs(hhh_csv);
+    if (!hhh_ofs) {
+        std::cerr << "[ERROR] Could not open output file: "
+                  << hhh_csv << std::endl;
+        return;
+    }
 
-    runHHExperiments();
+    hhh_ofs << "k,tilde_k,eps,levels,stream_len,"
+               "single_pass_mean,single_pass_p5,single_pass_p95,"
+               "per_level_mean,per_level_p5,per_level_p95,"
+               "speedup,reported_prefixes\n";
 
-    runHHExperimentsCaida();
+    {
+        const double eps = DEFAULT_EPS;
 
-    return 0;
+        for (int k : k_grid) {
+            auto tilde_k = static_cast<size_t>(k*TILDE_K_FACTOR);
+            runHHHComparisonAgg(sched, hhh_ofs, stream, k, tilde_k, eps, stream_length);
+        }
+
+        sched.drain();
+        std::cout << "[INFO] Completed HHH comparison (CAIDA).\n\n";
+    }
+
+    hhh_ofs.close();
+    std::cout << "[DONE] CAIDA HHH results written to: "
+              << hhh_csv << std::endl;
+}
+
+// Live-feed mode: streams a CSV export, capture or named pipe through the
+// loader/consumer pipeline once, running every engine concurrently, and
+// reports throughput, stall times and the heavy hitters found. Memory stays
+// bounded by the ring, so the input may be longer than RAM.
+static constexpr size_t LIVE_HORIZON = size_t{1} << 32;
+
+void runHHLive(const std::string& path, int k = DEFAULT_K_CAIDA, double eps = DEFAULT_EPS,
+               uint64_t seed = DEFAULT_EXPERIMENT_SEED) {
+    const auto tilde_k = static_cast<size_t>(k*TILDE_K_FACTOR);
+    const uint64_t cms_seed = deriveSeed(seed, 0);
+    const uint64_t cs_seed = deriveSeed(seed, 1);
+
+    std::vector<std::pair<std::string, std::unique_ptr<SketchHH>>> engines;
+    engines.emplace_back("MGSO", std::make_unique<MGSO>(k, tilde_k, eps, DEFAULT_DELTA));
+    engines.emplace_back("SSSO", std::make_unique<SSSO>(k, tilde_k, eps, DEFAULT_DELTA));
+    engines.emplace_back("CMSSOHH", std::make_unique<CMSSOHH>(
+        DEFAULT_DEPTH, eps, DEFAULT_DELTA, k, 2*tilde_k, static_cast<uint32_t>(cms_seed), LIVE_HORIZON));
+    engines.emplace_back("CSSOHH", std::make_unique<CSSOHH>(
+        DEFAULT_DEPTH, eps, DEFAULT_DELTA, k, 2*tilde_k, static_cast<uint32_t>(cs_seed),
+        static_cast<uint32_t>(cs_seed >> 32), LIVE_HORIZON));
+
+    std::vector<SketchHH*> raw;
+    for (auto& e : engines) raw.push_back(e.second.get());
+
+    IngestPipeline::Source source;
+    if (isPcapPath(path)) {
+        source = [&](const IngestPipeline::Sink& sink) {
+            PcapReader reader(path, PacketKey::SrcIP);
+            if (!reader.ok()) {
+                std::cerr << "[ERROR] Could not open capture: " << path << std::endl;
+                return;
+            }
+            reader.run([&](const int* keys, size_t n) { sink(keys, n); });
+        };
+    } else {
+        source = [&](const IngestPipeline::Sink& sink) {
+            CsvIpReader reader(path, CAIDA_SOURCE_COLUMN);
+            if (!reader.ok()) {
+                std::cerr << "[ERROR] Could not open feed: " << path << std::endl;
+                return;
+            }
+            reader.run([&](const int* keys, size_t n) { sink(keys, n); });
+        };
+    }
+
+    std::cout << "=== Live Heavy-Hitter Pipeline ===\n"
+              << "Feed: " << path << "\n"
+              << "k=" << k << " eps=" << eps << "\n\n";
+
+    IngestPipeline pipeline;
+    const PipelineStats stats = pipeline.run(source, raw);
+
+    std::cout << "items=" << stats.items
+              << " batches=" << stats.batches
+              << " wall(ms)=" << stats.wall_ms
+              << " Mitems/s=" << (stats.wall_ms > 0 ? stats.items / stats.wall_ms / 1e3 : 0.0)
+              << " ring(bytes)=" << stats.ring_bytes
+              << " loader stall(ms)=" << stats.producer_stall_ms << "\n";
+    for (size_t r = 0; r < engines.size(); ++r) {
+        std::cout << engines[r].first
+                  << " | busy(ms)=" << stats.consumer_busy_ms[r]
+                  << " stall(ms)=" << stats.consumer_stall_ms[r]
+                  << " | bytes=" << engines[r].second->memory_bytes()
+                  << " | reported=" << engines[r].second->query().size() << std::endl;
+    }
 }
 
+int main(int argc, char** argv) {
+    // --quiet runs every repeat serially for timing-only sweeps;
+    // --jobs N caps the number of pinned worker threads;
+    // --seed N seeds the generated streams and the engines' hashes;
+    // --live PATH streams one feed through the pipeline instead.
+    ExperimentScheduler::Mode mode = ExperimentScheduler::Mode::Parallel;
+    unsigned jobs = 0;
+    uint64_t seed = DEFAULT_EXPERIMENT_SEED;
+    std::string live_path;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--live" && i + 1 < argc) {
+            live_path = argv[++i];
+        } else if (arg == "--quiet") {
+            mode = ExperimentScheduler::Mode::Quiet;
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            jobs = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+        }
+    }
+
+    if (!live_path.empty()) {
+        runHHLive(live_path, DEFAULT_K_CAIDA, DEFAULT_EPS, seed);
+        return 0;
+    }
+
+    ExperimentScheduler sched(mode, jobs);
+    std::cout << "[INFO] Scheduler: "
+              << (mode == ExperimentScheduler::Mode::Quiet ? "quiet" : "parallel")
+              << ", workers=" << sched.workers()
+              << ", seed=" << seed << "\n";
+
+    runHHExperiments(sched, seed);
+
+    runHHExperimentsCaida(sched, seed);
 
+    return 0;
+}
@@ -34,6 +34,11 @@ public:
         }
     }
 
+    void reset(uint32_t new_seed) override {
+        seed = new_seed;
+        for (auto& row : table) fill(row.begin(), row.end(), 0);
+    }
+
     double query(int item) const override {
         int minCount = INT_MAX;
         for (int i = 0; i < depth; ++i) {
@@ -44,6 +49,15 @@ public:
         return minCount;
     }
 
+    MemoryBreakdown memory_breakdown() const override {
+        MemoryBreakdown m;
+        m.add("object", sizeof(*this));
+        size_t rows = vectorBytes(table);
+        for (const auto& row : table) rows += vectorBytes(row);
+        m.add("table", rows);
+        return m;
+    }
+
     void printTable() const {
         for (int i = 0; i < depth; ++i) {
             for (int j = 0; j < width; ++j) {
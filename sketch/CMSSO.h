@@ -6,8 +6,12 @@
 #include <vector>
 #include <cstdint>
 #include <algorithm>
+#include <memory>
+#include <stdexcept>
 
 #include "Sketch.h"
+#include "CompactCounters.h"
+#include "../help/Snapshot.h"
 
 using namespace std;
 
@@ -19,56 +23,258 @@ private:
     uint32_t seed;
     vector<vector<double>> table;
 
-public:
+    // Compact layout: exact counts in counts_, noise derived per cell from
+    // noise_key_ at read time. table is then empty.
+    CompactCounters counts_;
+    uint64_t noise_key_{0};
+    double noise_eps_{0.0};  // both layouts; 0 after load()
 
-    CMSSO(int width, int depth, double epsilon,  uint32_t seed)
-    : width(width), depth(depth), seed(seed) {
-        table = vector<vector<double>>(depth, vector<double>(width, 0));
-        for (int i = 0; i < depth; i++) {
-            for (int j = 0; j < width; j++) {
-                table[i][j] = laplaceNoise(epsilon, 2*depth);
-            }
+    // Released (noisy) value of row i, column j in either layout.
+    [[nodiscard]] double cell(int i, uint32_t j) const {
+        if (!compact()) return table[i][j];
+        const size_t c = static_cast<size_t>(i) * width + j;
+        return static_cast<double>(counts_.get(c)) + laplaceNoiseAt(noise_key_, c, noise_eps_, 2*depth);
+    }
+
+    void prefetchCell(int i, uint32_t j) const {
+        if (compact()) counts_.prefetch(static_cast<size_t>(i) * width + j);
+        else __builtin_prefetch(table[i].data() + j);
+    }
+
+    // Fresh noise: a new 64-bit key from random_device (rng has only a 32-bit
+    // seed), which is all the compact layout needs. The table is filled from
+    // the same keyed draws, one pass without RNG state.
+    void drawNoise() {
+        random_device rd;
+        noise_key_ = (static_cast<uint64_t>(rd()) << 32) | rd();
+        if (compact()) return;
+        for (int i = 0; i < depth; ++i) {
+            double* row = table[i].data();
+            const size_t base = static_cast<size_t>(i) * width;
+            for (int j = 0; j < width; ++j) row[j] = laplaceNoiseAt(noise_key_, base + j, noise_eps_, 2*depth);
         }
     }
 
+    template<typename RowHash>
+    double updateEstimateWith(RowHash&& row_hash, int count) {
+        double estimate = std::numeric_limits<double>::max();
+
+        if (compact()) {
+            return counts_.burst(depth, [&](auto cells) {
+                for (int i = 0; i < depth; ++i) {
+                    uint32_t hashValue = row_hash(i) % width;
+                    const auto c = cells.add(static_cast<size_t>(i) * width + hashValue, count);
+                    estimate = min(estimate, static_cast<double>(c));
+                }
+                return estimate;
+            });
+        }
+
+        for (int i = 0; i < depth; ++i) {
+            uint32_t hashValue = row_hash(i) % width;
+            table[i][hashValue] += count;
+            estimate = min(estimate, table[i][hashValue]);
+        }
+        return estimate;
+    }
+
+    // Used by load(): no noise is drawn, the table comes from the snapshot.
+    CMSSO(int width, int depth, uint32_t seed)
+    : width(width), depth(depth), seed(seed),
+      table(depth, vector<double>(width, 0)) {}
+
+public:
+
+    // counter_bits 8 or 16 selects the compact layout; 0 keeps a table of
+    // doubles with the noise drawn up front.
+    CMSSO(int width, int depth, double epsilon,  uint32_t seed, int counter_bits = 0)
+    : width(width), depth(depth), seed(seed), noise_eps_(epsilon) {
+        if (counter_bits) counts_ = CompactCounters(static_cast<size_t>(depth) * width, counter_bits);
+        else table = vector<vector<double>>(depth, vector<double>(width, 0));
+        drawNoise();
+    }
+
+    // A sketch restored by load() does not know its epsilon; use the
+    // two-argument form for it.
+    void reset(uint32_t new_seed) override {
+        if (noise_eps_ <= 0.0) throw logic_error("CMSSO::reset: epsilon unknown, pass it explicitly");
+        reset(new_seed, noise_eps_);
+    }
+
+    void reset(uint32_t new_seed, double epsilon) {
+        seed = new_seed;
+        noise_eps_ = epsilon;
+        counts_.clear();
+        drawNoise();
+    }
+
     void update(int item, int count) override {
+        if (compact()) {
+            counts_.burst(depth, [&](auto cells) {
+                for (int i = 0; i < depth; ++i) {
+                    cells.add(static_cast<size_t>(i) * width + hash(item, seed+i) % width, count);
+                }
+            });
+            return;
+        }
         for (int i = 0; i < depth; ++i) {
             uint32_t hashValue = hash(item, seed+i) % width;
             table[i][hashValue] += count;
         }
     }
 
+    [[nodiscard]] bool compact() const { return counts_.bits() != 0; }
+
+    // In the compact layout the estimate returned is the exact, un-noised
+    // one: callers may rank with it but must not release it.
     double update_estimate(int item, int count) {
-        double estimate = std::numeric_limits<double>::max();
+        return updateEstimateWith([&](int i) { return hash(item, seed + i); }, count);
+    }
+
+    // update_estimate() with the row hashes computed by the caller, e.g.
+    // once for several sketches: h[i] = hash(item, hash_seed() + i).
+    double update_estimate_hashed(const uint32_t* h, int count) {
+        return updateEstimateWith([h](int i) { return h[i]; }, count);
+    }
 
+    // Keys per group of query_batch().
+    static constexpr size_t QUERY_GROUP = 16;
+
+    // query() of items[0..n) into out. Keys go in groups: the row hashes of
+    // a whole group first (one row at a time, so the loop over keys
+    // vectorises), with a prefetch of each cell, then the reads, so the cache
+    // misses of a group overlap instead of queuing one after another.
+    void query_batch(const int* items, size_t n, double* out) const {
+        vector<uint32_t> cols(QUERY_GROUP * depth);
+        for (size_t at = 0; at < n; at += QUERY_GROUP) {
+            const size_t m = min(QUERY_GROUP, n - at);
+            for (int i = 0; i < depth; ++i) {
+                uint32_t* col = &cols[static_cast<size_t>(i) * QUERY_GROUP];
+                const uint32_t row_seed = seed + i;
+                for (size_t j = 0; j < m; ++j) col[j] = hash(items[at + j], row_seed);
+                for (size_t j = 0; j < m; ++j) {
+                    col[j] %= width;
+                    prefetchCell(i, col[j]);
+                }
+            }
+            for (size_t j = 0; j < m; ++j) {
+                double minCount = INT_MAX;
+                for (int i = 0; i < depth; ++i) {
+                    minCount = min(minCount, cell(i, cols[static_cast<size_t>(i) * QUERY_GROUP + j]));
+                }
+                out[at + j] = minCount;
+            }
+        }
+    }
+
+    [[nodiscard]] uint32_t hash_seed() const { return seed; }
+    [[nodiscard]] int rows() const { return depth; }
+
+    // query() on the scale update_estimate() returns: exact counts in the
+    // compact layout, the noisy table otherwise. For ranking, never release.
+    [[nodiscard]] double rank_query(int item) const {
+        if (!compact()) return query(item);
+        int64_t minCount = INT64_MAX;
         for (int i = 0; i < depth; ++i) {
-            uint32_t hashValue = hash(item, seed + i) % width;
-            table[i][hashValue] += count;
-            estimate = min(estimate, table[i][hashValue]);
+            const size_t c = static_cast<size_t>(i) * width + hash(item, seed+i) % width;
+            minCount = min(minCount, counts_.get(c));
         }
-        return estimate;
+        return static_cast<double>(minCount);
     }
 
     double query(int item) const override {
         double minCount = INT_MAX;
         for (int i = 0; i < depth; ++i) {
             uint32_t hashValue = hash(item, seed+i) % width;
-            double estimate = table[i][hashValue];
+            double estimate = cell(i, hashValue);
             minCount = (minCount < estimate) ? minCount : estimate;
         }
         return minCount;
     }
 
+    MemoryBreakdown memory_breakdown() const override {
+        MemoryBreakdown m;
+        m.add("object", sizeof(*this));
+        size_t rows = vectorBytes(table);
+        for (const auto& row : table) rows += vectorBytes(row);
+        m.add("table", rows);
+        if (compact()) m.add("counters", counts_.memory_breakdown());
+        return m;
+    }
+
+    // Rows are written as one aligned depth x width block, so CMSSOView can
+    // query a mapped snapshot without loading it. The compact layout writes
+    // its noisy cells, so it reloads as a plain table.
+    void save(SnapshotWriter& w) const {
+        const size_t at = w.beginSection(SnapshotKind::CMSSO);
+        w.put<int32_t>(width);
+        w.put<int32_t>(depth);
+        w.put<uint32_t>(seed);
+        vector<double> row(width);
+        for (int i = 0; i < depth; ++i) {
+            for (int j = 0; j < width; ++j) row[j] = cell(i, j);
+            w.putArray(row.data(), row.size());
+        }
+        w.endSection(at);
+    }
+
+    static unique_ptr<CMSSO> load(SnapshotReader& r) {
+        if (!r.section(SnapshotKind::CMSSO)) return nullptr;
+        const auto w = r.get<int32_t>();
+        const auto d = r.get<int32_t>();
+        const auto s = r.get<uint32_t>();
+        if (!r.ok() || w <= 0 || d <= 0) return nullptr;
+        unique_ptr<CMSSO> out(new CMSSO(w, d, s));
+        for (auto& row : out->table) {
+            if (!r.getArray(row.data(), row.size())) return nullptr;
+        }
+        return out;
+    }
+
     void printTable() const {
         for (int i = 0; i < depth; ++i) {
             for (int j = 0; j < width; ++j) {
-                cout << table[i][j] << " ";
+                cout << cell(i, j) << " ";
             }
-            printf("Table width: %llu", table[i].size());
+            printf("Table width: %d", width);
             cout << std::endl;
         }
     }
 };
 
 
+// Read-only CMSSO over a snapshot held in memory, typically a MappedFile.
+// Queries read the table in place; nothing is copied or re-noised.
+class CMSSOView {
+public:
+    explicit CMSSOView(SnapshotReader& r) {
+        if (!r.section(SnapshotKind::CMSSO)) return;
+        width = r.get<int32_t>();
+        depth = r.get<int32_t>();
+        seed = r.get<uint32_t>();
+        if (!r.ok() || width <= 0 || depth <= 0) return;
+        rows.resize(depth);
+        for (auto& row : rows) row = r.view<double>(width);
+        if (!r.ok()) rows.clear();
+    }
+
+    [[nodiscard]] bool ok() const { return !rows.empty(); }
+
+    [[nodiscard]] double query(int item) const {
+        double minCount = INT_MAX;
+        for (int i = 0; i < depth; ++i) {
+            uint32_t hashValue = Sketch::hash(item, seed+i) % width;
+            minCount = min(minCount, rows[i][hashValue]);
+        }
+        return minCount;
+    }
+
+private:
+    int width{0};
+    int depth{0};
+    uint32_t seed{0};
+    vector<const double*> rows;
+};
+
+
 #endif //CMSSO_H
@@ -38,6 +38,13 @@ public:
         }
     }
 
+    // Sign hashes take the depth seeds after the index ones.
+    void reset(uint32_t seed) override {
+        seed_index = seed;
+        seed_sign = seed + depth;
+        for (auto& row : table) fill(row.begin(), row.end(), 0);
+    }
+
     double query(int item) const override {
         vector<int> estimates;
         for (int i = 0; i < depth; ++i) {
@@ -49,6 +56,15 @@ public:
         sort(estimates.begin(), estimates.end());
         return estimates[depth / 2];
     }
+
+    MemoryBreakdown memory_breakdown() const override {
+        MemoryBreakdown m;
+        m.add("object", sizeof(*this));
+        size_t rows = vectorBytes(table);
+        for (const auto& row : table) rows += vectorBytes(row);
+        m.add("table", rows);
+        return m;
+    }
 };
 
 
@@ -7,8 +7,12 @@
 #include <cstdint>
 #include <algorithm>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 
 #include "Sketch.h"
+#include "CompactCounters.h"
+#include "../help/Snapshot.h"
 
 using namespace std;
 
@@ -21,37 +25,66 @@ private:
     uint32_t seed_sign;
     vector<vector<double>> table;
 
-    static int signFunction(int item, uint32_t seed) {
-        return (hash(item, seed) & 1) ? 1 : -1;
+    // Compact layout, as in CMSSO: exact counts in counts_, noise derived per
+    // cell from noise_key_ at read time. table is then empty.
+    CompactCounters counts_;
+    uint64_t noise_key_{0};
+    double noise_eps_{0.0};  // both layouts; 0 after load()
+
+    [[nodiscard]] double cell(int i, uint32_t j) const {
+        if (!compact()) return table[i][j];
+        const size_t c = static_cast<size_t>(i) * width + j;
+        return static_cast<double>(counts_.get(c)) + laplaceNoiseAt(noise_key_, c, noise_eps_, 2*depth);
     }
 
-public:
+    void prefetchCell(int i, uint32_t j) const {
+        if (compact()) counts_.prefetch(static_cast<size_t>(i) * width + j);
+        else __builtin_prefetch(table[i].data() + j);
+    }
 
-    CSSO(int width, int depth, double epsilon,  uint32_t seed_index, uint32_t seed_sign)
-    : width(width), depth(depth), seed_index(seed_index), seed_sign(seed_sign) {
-        table = vector<vector<double>>(depth, vector<double>(width, 0));
-        for (int i = 0; i < depth; i++) {
-            for (int j = 0; j < width; j++) {
-                table[i][j] = laplaceNoise(epsilon, 2*depth);
-            }
+    // Fresh noise: a new 64-bit key from random_device (rng has only a 32-bit
+    // seed), which is all the compact layout needs. The table is filled from
+    // the same keyed draws, one pass without RNG state.
+    void drawNoise() {
+        random_device rd;
+        noise_key_ = (static_cast<uint64_t>(rd()) << 32) | rd();
+        if (compact()) return;
+        for (int i = 0; i < depth; ++i) {
+            double* row = table[i].data();
+            const size_t base = static_cast<size_t>(i) * width;
+            for (int j = 0; j < width; ++j) row[j] = laplaceNoiseAt(noise_key_, base + j, noise_eps_, 2*depth);
         }
     }
 
+    // Used by load(): no noise is drawn, the table comes from the snapshot.
+    CSSO(int width, int depth, uint32_t seed_index, uint32_t seed_sign)
+    : width(width), depth(depth), seed_index(seed_index), seed_sign(seed_sign),
+      table(depth, vector<double>(width, 0)) {}
 
-    void update(int item, int count) override {
-        for (int i = 0; i < depth; ++i) {
-            uint32_t hashValue = hash(item, seed_index + i) % width;
-            int sign = signFunction(item, seed_sign + i);
-            table[i][hashValue] += sign * count;
-        }
+    static int signFunction(int item, uint32_t seed) {
+        return (hash(item, seed) & 1) ? 1 : -1;
     }
 
-    double update_estimate(int item, int count) {
+    template<typename IndexHash, typename SignHash>
+    double updateEstimateWith(IndexHash&& index_hash, SignHash&& sign_hash, int count) {
         vector<int> estimates(depth);
 
+        if (compact()) {
+            counts_.burst(depth, [&](auto cells) {
+                for (int i = 0; i < depth; ++i) {
+                    uint32_t hashValue = index_hash(i) % width;
+                    int sign = (sign_hash(i) & 1) ? 1 : -1;
+                    const auto c = cells.add(static_cast<size_t>(i) * width + hashValue, sign * count);
+                    estimates[i] = static_cast<int>(sign * c);
+                }
+            });
+            nth_element(estimates.begin(), estimates.begin() + depth / 2, estimates.end());
+            return estimates[depth / 2];
+        }
+
         for (int i = 0; i < depth; ++i) {
-            uint32_t hashValue = hash(item, seed_index + i) % width;
-            int sign = signFunction(item, seed_sign + i);
+            uint32_t hashValue = index_hash(i) % width;
+            int sign = (sign_hash(i) & 1) ? 1 : -1;
 
             table[i][hashValue] += sign * count;
             estimates[i] = sign * table[i][hashValue];
@@ -65,12 +98,124 @@ public:
         return estimates[depth / 2];
     }
 
+    friend class CSSOView;
+
+public:
+
+    // counter_bits 8 or 16 selects the compact layout; see CMSSO.
+    CSSO(int width, int depth, double epsilon,  uint32_t seed_index, uint32_t seed_sign, int counter_bits = 0)
+    : width(width), depth(depth), seed_index(seed_index), seed_sign(seed_sign), noise_eps_(epsilon) {
+        if (counter_bits) counts_ = CompactCounters(static_cast<size_t>(depth) * width, counter_bits);
+        else table = vector<vector<double>>(depth, vector<double>(width, 0));
+        drawNoise();
+    }
+
+    // Sign hashes take the depth seeds after the index ones. As in CMSSO, a
+    // loaded sketch needs the explicit form.
+    void reset(uint32_t seed) override {
+        if (noise_eps_ <= 0.0) throw logic_error("CSSO::reset: epsilon unknown, pass it explicitly");
+        reset(seed, seed + depth, noise_eps_);
+    }
+
+    void reset(uint32_t new_seed_index, uint32_t new_seed_sign, double epsilon) {
+        seed_index = new_seed_index;
+        seed_sign = new_seed_sign;
+        noise_eps_ = epsilon;
+        counts_.clear();
+        drawNoise();
+    }
+
+
+    void update(int item, int count) override {
+        if (compact()) {
+            counts_.burst(depth, [&](auto cells) {
+                for (int i = 0; i < depth; ++i) {
+                    uint32_t hashValue = hash(item, seed_index + i) % width;
+                    cells.add(static_cast<size_t>(i) * width + hashValue, signFunction(item, seed_sign + i) * count);
+                }
+            });
+            return;
+        }
+        for (int i = 0; i < depth; ++i) {
+            uint32_t hashValue = hash(item, seed_index + i) % width;
+            int sign = signFunction(item, seed_sign + i);
+            table[i][hashValue] += sign * count;
+        }
+    }
+
+    [[nodiscard]] bool compact() const { return counts_.bits() != 0; }
+
+    // In the compact layout the estimate returned is the exact, un-noised
+    // one: callers may rank with it but must not release it.
+    double update_estimate(int item, int count) {
+        return updateEstimateWith([&](int i) { return hash(item, seed_index + i); },
+                                  [&](int i) { return hash(item, seed_sign + i); }, count);
+    }
+
+    // update_estimate() with the row hashes computed by the caller:
+    // hi[i] = hash(item, index_seed() + i), hs[i] = hash(item, sign_seed() + i).
+    // A CMSSO whose hash_seed() equals either seed can share that array.
+    double update_estimate_hashed(const uint32_t* hi, const uint32_t* hs, int count) {
+        return updateEstimateWith([hi](int i) { return hi[i]; }, [hs](int i) { return hs[i]; }, count);
+    }
+
+    // Keys per group of query_batch().
+    static constexpr size_t QUERY_GROUP = 16;
+
+    // query() of items[0..n) into out, grouped and prefetched as in
+    // CMSSO::query_batch(); the sign hashes are computed alongside.
+    void query_batch(const int* items, size_t n, double* out) const {
+        vector<uint32_t> cols(QUERY_GROUP * depth);
+        vector<uint32_t> signs(QUERY_GROUP * depth);
+        vector<int> estimates(depth);
+        for (size_t at = 0; at < n; at += QUERY_GROUP) {
+            const size_t m = min(QUERY_GROUP, n - at);
+            for (int i = 0; i < depth; ++i) {
+                uint32_t* col = &cols[static_cast<size_t>(i) * QUERY_GROUP];
+                uint32_t* sign = &signs[static_cast<size_t>(i) * QUERY_GROUP];
+                const uint32_t index_seed = seed_index + i;
+                const uint32_t sign_seed = seed_sign + i;
+                for (size_t j = 0; j < m; ++j) col[j] = hash(items[at + j], index_seed);
+                for (size_t j = 0; j < m; ++j) sign[j] = hash(items[at + j], sign_seed);
+                for (size_t j = 0; j < m; ++j) {
+                    col[j] %= width;
+                    prefetchCell(i, col[j]);
+                }
+            }
+            for (size_t j = 0; j < m; ++j) {
+                for (int i = 0; i < depth; ++i) {
+                    const size_t g = static_cast<size_t>(i) * QUERY_GROUP + j;
+                    const int s = (signs[g] & 1) ? 1 : -1;
+                    estimates[i] = static_cast<int>(s * cell(i, cols[g]));
+                }
+                nth_element(estimates.begin(), estimates.begin() + depth / 2, estimates.end());
+                out[at + j] = estimates[depth / 2];
+            }
+        }
+    }
+
+    [[nodiscard]] uint32_t index_seed() const { return seed_index; }
+    [[nodiscard]] uint32_t sign_seed() const { return seed_sign; }
+    [[nodiscard]] int rows() const { return depth; }
+
+    // query() on the scale update_estimate() returns; see CMSSO.
+    [[nodiscard]] double rank_query(int item) const {
+        if (!compact()) return query(item);
+        vector<int> estimates(depth);
+        for (int i = 0; i < depth; ++i) {
+            const size_t c = static_cast<size_t>(i) * width + hash(item, seed_index + i) % width;
+            estimates[i] = static_cast<int>(signFunction(item, seed_sign + i) * counts_.get(c));
+        }
+        nth_element(estimates.begin(), estimates.begin() + depth / 2, estimates.end());
+        return estimates[depth / 2];
+    }
+
     [[nodiscard]] double query(int item) const override {
         vector<int> estimates;
         for (int i = 0; i < depth; ++i) {
             uint32_t hashValue = hash(item, seed_index + i) % width;
             int sign = signFunction(item, seed_sign + i);
-            estimates.push_back(sign * table[i][hashValue]);
+            estimates.push_back(sign * cell(i, hashValue));
         }
 
         sort(estimates.begin(), estimates.end());
@@ -84,7 +229,7 @@ public:
         for (int r = 0; r < depth; ++r) {
             double Sr = 0.0;
             for (int b = 0; b < width; ++b) {
-                double a = table[r][b];
+                double a = cell(r, b);
                 Sr += a * a;
             }
             rowEstimates.push_back(Sr);
@@ -108,16 +253,94 @@ public:
         }
     }
 
+    MemoryBreakdown memory_breakdown() const override {
+        MemoryBreakdown m;
+        m.add("object", sizeof(*this));
+        size_t rows = vectorBytes(table);
+        for (const auto& row : table) rows += vectorBytes(row);
+        m.add("table", rows);
+        if (compact()) m.add("counters", counts_.memory_breakdown());
+        return m;
+    }
+
+    // Same layout as CMSSO::save(); CSSOView queries it in place. The compact
+    // layout writes its noisy cells.
+    void save(SnapshotWriter& w) const {
+        const size_t at = w.beginSection(SnapshotKind::CSSO);
+        w.put<int32_t>(width);
+        w.put<int32_t>(depth);
+        w.put<uint32_t>(seed_index);
+        w.put<uint32_t>(seed_sign);
+        vector<double> row(width);
+        for (int i = 0; i < depth; ++i) {
+            for (int j = 0; j < width; ++j) row[j] = cell(i, j);
+            w.putArray(row.data(), row.size());
+        }
+        w.endSection(at);
+    }
+
+    static unique_ptr<CSSO> load(SnapshotReader& r) {
+        if (!r.section(SnapshotKind::CSSO)) return nullptr;
+        const auto w = r.get<int32_t>();
+        const auto d = r.get<int32_t>();
+        const auto si = r.get<uint32_t>();
+        const auto ss = r.get<uint32_t>();
+        if (!r.ok() || w <= 0 || d <= 0) return nullptr;
+        unique_ptr<CSSO> out(new CSSO(w, d, si, ss));
+        for (auto& row : out->table) {
+            if (!r.getArray(row.data(), row.size())) return nullptr;
+        }
+        return out;
+    }
+
     void printTable() const {
         for (int i = 0; i < depth; ++i) {
             for (int j = 0; j < width; ++j) {
-                cout << table[i][j] << " ";
+                cout << cell(i, j) << " ";
             }
-            printf("Table width: %llu", table[i].size());
+            printf("Table width: %d", width);
             cout << std::endl;
         }
     }
 };
 
 
+// Read-only CSSO over a snapshot held in memory, typically a MappedFile.
+class CSSOView {
+public:
+    explicit CSSOView(SnapshotReader& r) {
+        if (!r.section(SnapshotKind::CSSO)) return;
+        width = r.get<int32_t>();
+        depth = r.get<int32_t>();
+        seed_index = r.get<uint32_t>();
+        seed_sign = r.get<uint32_t>();
+        if (!r.ok() || width <= 0 || depth <= 0) return;
+        rows.resize(depth);
+        for (auto& row : rows) row = r.view<double>(width);
+        if (!r.ok()) rows.clear();
+    }
+
+    [[nodiscard]] bool ok() const { return !rows.empty(); }
+
+    [[nodiscard]] double query(int item) const {
+        vector<int> estimates;
+        estimates.reserve(depth);
+        for (int i = 0; i < depth; ++i) {
+            uint32_t hashValue = Sketch::hash(item, seed_index + i) % width;
+            int sign = CSSO::signFunction(item, seed_sign + i);
+            estimates.push_back(sign * rows[i][hashValue]);
+        }
+        nth_element(estimates.begin(), estimates.begin() + depth / 2, estimates.end());
+        return estimates[depth / 2];
+    }
+
+private:
+    int width{0};
+    int depth{0};
+    uint32_t seed_index{0};
+    uint32_t seed_sign{0};
+    vector<const double*> rows;
+};
+
+
 #endif //CSSO_H
@@ -0,0 +1,172 @@
+
+#ifndef COMPACTCOUNTERS_H
+#define COMPACTCOUNTERS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "../help/CountingAllocator.h"
+
+using namespace std;
+
+// Exact signed counters stored in 8 or 16 bits each, for sketch tables whose
+// cells mostly stay small.
+//
+// The lowest 1/8 of a base counter's range is reserved: a value there is the
+// index of the cell in a side array of 64-bit counters. A cell whose value
+// leaves the remaining range is promoted into the side array and stays there,
+// so a read of a hot cell costs one extra, direct load. Once the reserved
+// indices run out the whole table is widened (8 -> 16 -> 32 bits) and the
+// promotions are redone. Reads of unpromoted cells touch one byte or two, so
+// a depth x width table is 4-8x smaller than with 64-bit cells and more of it
+// stays in cache.
+class CompactCounters {
+public:
+    CompactCounters() = default;
+
+    // bits: 8 or 16.
+    CompactCounters(size_t cells, int bits) : bits_(bits == 8 ? 8 : 16) {
+        if (bits_ == 8) c8_.assign(cells, 0);
+        else c16_.assign(cells, 0);
+    }
+
+    // Current base width; grows when the table is widened.
+    [[nodiscard]] int bits() const { return bits_; }
+    [[nodiscard]] size_t promoted() const { return wide_.size(); }
+
+    [[nodiscard]] int64_t get(size_t cell) const {
+        switch (bits_) {
+            case 8:  return getIn(c8_, cell);
+            case 16: return getIn(c16_, cell);
+            default: return getIn(c32_, cell);
+        }
+    }
+
+    // Pulls the cache line of cell ahead of a get().
+    void prefetch(size_t cell) const {
+        switch (bits_) {
+            case 8:  __builtin_prefetch(c8_.data() + cell); break;
+            case 16: __builtin_prefetch(c16_.data() + cell); break;
+            default: __builtin_prefetch(c32_.data() + cell); break;
+        }
+    }
+
+    // Runs f(cells) for a burst of at most n adds, with the width dispatch
+    // done once: cells.add(cell, delta) adds and returns the new value.
+    // Headroom for n promotions is made up front, so a burst never widens.
+    template<typename F>
+    decltype(auto) burst(size_t n, F&& f) {
+        if (bits_ == 8 && static_cast<int64_t>(wide_.size() + n) > reserved<int8_t>()) widen();
+        if (bits_ == 16 && static_cast<int64_t>(wide_.size() + n) > reserved<int16_t>()) widen();
+        switch (bits_) {
+            case 8:  return f(Cells<int8_t>{*this, c8_});
+            case 16: return f(Cells<int16_t>{*this, c16_});
+            default: return f(Cells<int32_t>{*this, c32_});
+        }
+    }
+
+    // Adds delta and returns the new value.
+    int64_t add(size_t cell, int64_t delta) {
+        return burst(1, [&](auto cells) { return cells.add(cell, delta); });
+    }
+
+    // Zeroes every cell and drops the promotions. The table keeps its current
+    // width, so a table that had to widen does not widen again.
+    void clear() {
+        fill(c8_.begin(), c8_.end(), 0);
+        fill(c16_.begin(), c16_.end(), 0);
+        fill(c32_.begin(), c32_.end(), 0);
+        wide_.clear();
+    }
+
+    MemoryBreakdown memory_breakdown() const {
+        MemoryBreakdown m;
+        m.add("base", vectorBytes(c8_) + vectorBytes(c16_) + vectorBytes(c32_));
+        m.add("promoted", vectorBytes(wide_));
+        return m;
+    }
+
+private:
+    template<typename B>
+    struct Cells {
+        CompactCounters& owner;
+        vector<B>& base;
+
+        int64_t add(size_t cell, int64_t delta) const {
+            return owner.addIn(base, cell, delta);
+        }
+    };
+
+    int bits_{0};
+    vector<int8_t> c8_;
+    vector<int16_t> c16_;
+    vector<int32_t> c32_;
+    vector<int64_t> wide_;
+
+    template<typename B>
+    static constexpr int64_t reserved() { return int64_t{1} << (8 * sizeof(B) - 3); }
+
+    // Smallest value held inline.
+    template<typename B>
+    static constexpr int64_t inlineMin() { return static_cast<int64_t>(numeric_limits<B>::min()) + reserved<B>(); }
+
+    template<typename B>
+    int64_t getIn(const vector<B>& base, size_t cell) const {
+        const int64_t v = base[cell];
+        if (v >= inlineMin<B>()) return v;
+        return wide_[v - numeric_limits<B>::min()];
+    }
+
+    // Callers make sure a promotion finds a free index (see burst()).
+    template<typename B>
+    int64_t addIn(vector<B>& base, size_t cell, int64_t delta) {
+        const int64_t v = base[cell];
+        if (v < inlineMin<B>()) return wide_[v - numeric_limits<B>::min()] += delta;
+
+        const int64_t out = v + delta;
+        // One unsigned compare for inlineMin <= out <= max.
+        constexpr auto span = static_cast<uint64_t>(numeric_limits<B>::max() - inlineMin<B>());
+        if (static_cast<uint64_t>(out - inlineMin<B>()) <= span) {
+            base[cell] = static_cast<B>(out);
+        } else {
+            base[cell] = static_cast<B>(numeric_limits<B>::min() + static_cast<int64_t>(wide_.size()));
+            wide_.push_back(out);
+        }
+        return out;
+    }
+
+    // Re-encodes values at base width B; false if they need more promoted
+    // cells than B can index.
+    template<typename B>
+    bool rebuild(const vector<int64_t>& values, vector<B>& to) {
+        constexpr auto span = static_cast<uint64_t>(numeric_limits<B>::max() - inlineMin<B>());
+        int64_t wide = 0;
+        for (int64_t v : values) wide += static_cast<uint64_t>(v - inlineMin<B>()) > span;
+        if (wide > reserved<B>()) return false;
+
+        wide_.clear();
+        to.assign(values.size(), 0);
+        for (size_t c = 0; c < values.size(); ++c) addIn(to, c, values[c]);
+        return true;
+    }
+
+    // 32-bit cells reserve 2^29 indices, more than any table has cells, so
+    // widening always ends there at the latest.
+    void widen() {
+        vector<int64_t> values(c8_.size() + c16_.size() + c32_.size());
+        for (size_t c = 0; c < values.size(); ++c) values[c] = get(c);
+        vector<int8_t>().swap(c8_);
+        vector<int16_t>().swap(c16_);
+
+        if (bits_ == 8 && rebuild(values, c16_)) {
+            bits_ = 16;
+            return;
+        }
+        rebuild(values, c32_);
+        bits_ = 32;
+    }
+};
+
+#endif //COMPACTCOUNTERS_H
@@ -5,15 +5,17 @@
 #include <cstdint>
 #include <bits/random.h>
 #include <random>
+#include <cmath>
 
 #include "../hash/MurmurHash.h"
+#include "../help/CountingAllocator.h"
 
 using namespace std;
 
 class Sketch {
 
 protected:
-    static mt19937 rng;
+    static thread_local mt19937 rng;
 
 public:
 
@@ -22,10 +24,17 @@ public:
     virtual void update(int item, int count) = 0;
     virtual double query(int item) const = 0;
 
-    static uint32_t hash(uint32_t item, unsigned int seed) {
-        uint32_t hash_val;
-        MurmurHash3_x86_32(&item, sizeof(item), seed, &hash_val);
-        return hash_val;
+    // Returns the sketch to its freshly built state under hash seed `seed`,
+    // in the memory it already holds: counters are zeroed and any noise is
+    // drawn anew.
+    virtual void reset(uint32_t seed) = 0;
+
+    // Bytes held by the sketch, including the object itself.
+    virtual MemoryBreakdown memory_breakdown() const = 0;
+    [[nodiscard]] size_t memory_bytes() const { return memory_breakdown().total(); }
+
+    FORCE_INLINE static uint32_t hash(uint32_t item, unsigned int seed) {
+        return MurmurHash3_x86_32_u32(item, seed);
     }
 
     static double laplaceNoise(double eps, double sensitivity) {
@@ -34,13 +43,26 @@ public:
         return (rng() % 2 == 0) ? noise : -noise;
     }
 
+    // Laplace noise fixed by (key, index): the same draw on every call and no
+    // stored state. Lets a sketch add its per-cell noise at read time; the
+    // key must stay secret, as the noise table would otherwise.
+    static double laplaceNoiseAt(uint64_t key, uint64_t index, double eps, double sensitivity) {
+        uint64_t z = key + (index + 1) * 0x9e3779b97f4a7c15ull;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        z ^= z >> 31;
+        const double u = (static_cast<double>(z >> 11) + 0.5) * 0x1.0p-53;  // (0, 1)
+        const double noise = -(sensitivity / eps) * log(u);
+        return (z & 1) ? noise : -noise;
+    }
+
     static double gaussianNoise(double sigma) {
         normal_distribution<double> norm_dist(0.0, sigma);
         return norm_dist(rng);
     }
 };
 
-mt19937 Sketch::rng(random_device{}());
+thread_local mt19937 Sketch::rng(random_device{}());
 
 
 #endif //SKETCH_H
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+# Writes the capture fixtures of test_pcap.cpp into this directory. The
+# packets are listed next to the expected keys in test_pcap.cpp; keep the two
+# in sync when editing either.
+import os
+import struct
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+def ipv4(src, dst, proto, l4, frag=0):
+    total = 20 + len(l4)
+    hdr = struct.pack(">BBHHHBBH4s4s", 0x45, 0, total, 1, frag, 64, proto, 0,
+                      bytes(src), bytes(dst))
+    return hdr + l4
+
+
+def ipv6(src, dst, next_header, payload):
+    hdr = struct.pack(">IHBB16s16s", 6 << 28, len(payload), next_header, 64,
+                      bytes(src), bytes(dst))
+    return hdr + payload
+
+
+def ports(sport, dport, rest=8):
+    return struct.pack(">HH", sport, dport) + bytes(rest)
+
+
+def eth(ethertype, payload, tags=()):
+    out = bytes([0x02, 0, 0, 0, 0, 1, 0x02, 0, 0, 0, 0, 2])
+    for tpid, vid in tags:
+        out += struct.pack(">HH", tpid, vid)
+    return out + struct.pack(">H", ethertype) + payload
+
+
+def sll(proto, payload):
+    return struct.pack(">HHH8sH", 0, 1, 6, bytes(8), proto) + payload
+
+
+def sll2(proto, payload):
+    return struct.pack(">HHIHBB8s", proto, 0, 2, 1, 0, 6, bytes(8)) + payload
+
+
+A = [10, 0, 0, 1]
+B = [192, 168, 1, 7]
+C = [172, 16, 5, 9]
+V6A = [0x20, 0x01, 0x0d, 0xb8] + [0] * 11 + [1]
+V6B = [0x20, 0x01, 0x0d, 0xb8] + [0] * 11 + [2]
+
+
+def pcap(path, linktype, frames, big_endian=False):
+    e = ">" if big_endian else "<"
+    with open(path, "wb") as f:
+        f.write(struct.pack(e + "IHHiIII", 0xa1b2c3d4, 2, 4, 0, 0, 65535, linktype))
+        for i, frame in enumerate(frames):
+            f.write(struct.pack(e + "IIII", i, 0, len(frame), len(frame) + 100))
+            f.write(frame)
+
+
+def block(kind, body):
+    body += bytes(-len(body) % 4)
+    n = 12 + len(body)
+    return struct.pack("<II", kind, n) + body + struct.pack("<I", n)
+
+
+def pcapng(path, interfaces, packets):
+    with open(path, "wb") as f:
+        f.write(block(0x0a0d0d0a, struct.pack("<IHHq", 0x1a2b3c4d, 1, 0, -1)))
+        for linktype in interfaces:
+            f.write(block(1, struct.pack("<HHI", linktype, 0, 65535)))
+        for iface, frame in packets:
+            if iface is None:  # simple packet block, first interface
+                f.write(block(3, struct.pack("<I", len(frame) + 100) + frame))
+            else:
+                f.write(block(6, struct.pack("<IIIII", iface, 0, 0, len(frame), len(frame) + 100) + frame))
+
+
+# Ethernet, classic pcap, little endian.
+pcap(os.path.join(HERE, "ethernet_vlan.pcap"), 1, [
+    eth(0x0800, ipv4(A, B, 6, ports(1234, 80))),
+    eth(0x0800, ipv4(B, C, 17, ports(53, 5353)), tags=[(0x8100, 10)]),
+    eth(0x0800, ipv4(C, A, 6, ports(443, 40000)), tags=[(0x88a8, 20), (0x8100, 30)]),
+    eth(0x86dd, ipv6(V6A, V6B, 17, ports(5000, 6000))),
+    eth(0x0806, bytes(28)),                                   # ARP: skipped
+    eth(0x0800, ipv4(A, C, 17, ports(9, 9), frag=0x0010)),    # later fragment: no ports
+])
+
+# Linux cooked (SLL), classic pcap, big endian.
+pcap(os.path.join(HERE, "sll.pcap"), 113, [
+    sll(0x0800, ipv4(B, A, 17, ports(123, 123))),
+    sll(0x86dd, ipv6(V6B, V6A, 6, ports(22, 50000))),
+], big_endian=True)
+
+# pcapng with an SLL2 and an Ethernet interface; IPv6 behind a hop-by-hop
+# extension header; the last packet is a simple packet block.
+hop_by_hop = bytes([17, 0]) + bytes(6)
+pcapng(os.path.join(HERE, "sll2_ethernet.pcapng"), [276, 1], [
+    (0, sll2(0x0800, ipv4(A, B, 6, ports(1000, 2000)))),
+    (0, sll2(0x86dd, ipv6(V6A, V6B, 0, hop_by_hop + ports(7, 8)))),
+    (1, eth(0x86dd, ipv6(V6B, V6A, 6, ports(443, 1024)), tags=[(0x8100, 5)])),
+    (None, sll2(0x0800, ipv4(C, B, 1, bytes(8)))),            # ICMP: no ports
+])
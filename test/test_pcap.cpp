@@ -0,0 +1,163 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../io/PcapReader.h"
+
+using namespace std;
+
+// Decodes the captures in test/pcap (written by make_fixtures.py) and checks
+// every key and byte count against values built here from the packet
+// contents. Exits non-zero if any check fails. Usage: test_pcap <fixture dir>
+
+static constexpr uint32_t SEED = 7;
+
+struct Addr {
+    uint8_t bytes[16]{};
+    int len{0};
+};
+
+static Addr v4(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    Addr out;
+    out.bytes[0] = a; out.bytes[1] = b; out.bytes[2] = c; out.bytes[3] = d;
+    out.len = 4;
+    return out;
+}
+
+static Addr v6(uint8_t last) {
+    Addr out;
+    out.bytes[0] = 0x20; out.bytes[1] = 0x01; out.bytes[2] = 0x0d; out.bytes[3] = 0xb8;
+    out.bytes[15] = last;
+    out.len = 16;
+    return out;
+}
+
+static const Addr A = v4(10, 0, 0, 1);
+static const Addr B = v4(192, 168, 1, 7);
+static const Addr C = v4(172, 16, 5, 9);
+static const Addr V6A = v6(1);
+static const Addr V6B = v6(2);
+
+struct Packet {
+    Addr src;
+    Addr dst;
+    uint8_t proto;
+    uint16_t sport;
+    uint16_t dport;
+    uint32_t wire_bytes;
+};
+
+// Murmur reads whole words; copying first keeps -O2 from reading the tuple
+// through uint32_t before its uint16_t/uint8_t stores land.
+static int murmur(const void* bytes, int len) {
+    uint32_t words[10];
+    memcpy(words, bytes, len);
+    uint32_t h;
+    MurmurHash3_x86_32(words, len, SEED, &h);
+    return static_cast<int>(h);
+}
+
+// Same layout as the tuple PcapReader folds.
+static int fiveTupleKey(const Packet& p) {
+    struct {
+        uint8_t src[16];
+        uint8_t dst[16];
+        uint16_t sport;
+        uint16_t dport;
+        uint8_t proto;
+        uint8_t pad[3];
+    } t{};
+    memcpy(t.src, p.src.bytes, p.src.len);
+    memcpy(t.dst, p.dst.bytes, p.dst.len);
+    t.sport = p.sport;
+    t.dport = p.dport;
+    t.proto = p.proto;
+    return murmur(&t, sizeof(t));
+}
+
+static int addrKey(const Addr& a) {
+    if (a.len == 4) {
+        return static_cast<int>((static_cast<uint32_t>(a.bytes[0]) << 24) | (a.bytes[1] << 16)
+                                | (a.bytes[2] << 8) | a.bytes[3]);
+    }
+    return murmur(a.bytes, 16);
+}
+
+static int failures = 0;
+
+static void check(bool ok, const string& what) {
+    if (!ok) {
+        fprintf(stderr, "FAIL %s\n", what.c_str());
+        ++failures;
+    }
+}
+
+static void checkCapture(const string& path, const vector<Packet>& expected, size_t skipped) {
+    for (PacketKey key : {PacketKey::SrcIP, PacketKey::DstIP, PacketKey::FiveTuple}) {
+        PcapReader reader(path, key, PacketWeight::Bytes, SEED);
+        check(reader.ok(), path + ": open");
+        vector<int> keys;
+        vector<uint32_t> weights;
+        reader.run([&](const int* k, const uint32_t* w, size_t n) {
+            keys.insert(keys.end(), k, k + n);
+            weights.insert(weights.end(), w, w + n);
+        });
+
+        const string name = path + " key " + to_string(static_cast<int>(key));
+        check(keys.size() == expected.size(), name + ": packet count");
+        check(reader.skipped() == skipped, name + ": skipped count");
+        for (size_t i = 0; i < expected.size() && i < keys.size(); ++i) {
+            const Packet& p = expected[i];
+            const int want = key == PacketKey::SrcIP ? addrKey(p.src)
+                           : key == PacketKey::DstIP ? addrKey(p.dst)
+                           : fiveTupleKey(p);
+            check(keys[i] == want, name + ": key of packet " + to_string(i));
+            check(weights[i] == p.wire_bytes, name + ": bytes of packet " + to_string(i));
+        }
+    }
+
+    // A two-argument sink gets the same keys and no weights.
+    PcapReader reader(path, PacketKey::FiveTuple, PacketWeight::Packets, SEED);
+    size_t n_keys = 0;
+    reader.run([&](const int*, size_t n) { n_keys += n; });
+    check(n_keys == expected.size(), path + ": unweighted sink");
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <fixture dir>\n", argv[0]);
+        return 2;
+    }
+    const string dir = argv[1];
+
+    // Captured lengths are the IP packet plus link header; the fixtures set
+    // the original length 100 bytes above that.
+    checkCapture(dir + "/ethernet_vlan.pcap", {
+        {A, B, 6, 1234, 80, 14 + 32 + 100},
+        {B, C, 17, 53, 5353, 18 + 32 + 100},
+        {C, A, 6, 443, 40000, 22 + 32 + 100},
+        {V6A, V6B, 17, 5000, 6000, 14 + 52 + 100},
+        {A, C, 17, 0, 0, 14 + 32 + 100},  // later fragment: ports not read
+    }, 1);                                   // ARP
+
+    checkCapture(dir + "/sll.pcap", {
+        {B, A, 17, 123, 123, 16 + 32 + 100},
+        {V6B, V6A, 6, 22, 50000, 16 + 52 + 100},
+    }, 0);
+
+    checkCapture(dir + "/sll2_ethernet.pcapng", {
+        {A, B, 6, 1000, 2000, 20 + 32 + 100},
+        {V6A, V6B, 17, 7, 8, 20 + 60 + 100},  // behind a hop-by-hop header
+        {V6B, V6A, 6, 443, 1024, 18 + 52 + 100},
+        {C, B, 1, 0, 0, 20 + 28 + 100},       // ICMP, simple packet block
+    }, 0);
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    puts("pcap: all checks passed");
+    return 0;
+}
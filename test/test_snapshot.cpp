@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../heavy/SSSO.h"
+#include "../heavy/MGSO.h"
+#include "../heavy/CMSSOHH.h"
+#include "../heavy/SSSOWindow.h"
+#include "../heavy/CMSSOHHWindow.h"
+#include "../heavy/ContinualCMSSOHH.h"
+#include "../heavy/HHHSSSO.h"
+#include "../heavy/HKSO.h"
+#include "../gen/ZipfGenerator.h"
+
+using namespace std;
+
+// Saves every engine mid-stream, loads it back and checks that the copy
+// answers query() and estimate() as the original does, before and after both
+// see the rest of the stream, and that both then save the same bytes.
+// Release noise is drawn from a shared generator, which is reseeded before
+// each query so both sides draw the same noise. Exits non-zero if any check
+// fails.
+
+static constexpr size_t STREAM = 200000;
+static constexpr size_t SPLIT = 120000;
+static constexpr int KEYS = 2000;
+
+struct NoiseSeed : SketchHH {
+    static void set(uint32_t s) { rng.seed(s); }
+};
+
+static int failures = 0;
+
+static void check(bool ok, const string& what) {
+    if (!ok) {
+        fprintf(stderr, "FAIL %s\n", what.c_str());
+        ++failures;
+    }
+}
+
+// Order-insensitive: hash-set iteration order is not part of the state.
+static vector<pair<int, double>> sorted(vector<pair<int, double>> v) {
+    sort(v.begin(), v.end());
+    return v;
+}
+
+static void compare(const string& name, SketchHH& a, SketchHH& b) {
+    NoiseSeed::set(1);
+    const auto qa = sorted(a.query());
+    NoiseSeed::set(1);
+    const auto qb = sorted(b.query());
+    check(qa == qb, name + ": query");
+
+    bool same = true;
+    for (int key = 0; key < KEYS; ++key) same &= a.estimate(key) == b.estimate(key);
+    check(same, name + ": estimate");
+}
+
+template<typename Engine>
+static void roundTrip(const string& name, unique_ptr<Engine> engine, const vector<int>& stream) {
+    for (size_t i = 0; i < SPLIT; ++i) engine->update(stream[i]);
+
+    SnapshotWriter w;
+    engine->save(w);
+    SnapshotReader r(w.bytes());
+    unique_ptr<Engine> copy = Engine::load(r);
+    check(copy != nullptr && r.ok(), name + ": load");
+    if (!copy) return;
+    check(r.position() == w.bytes().size(), name + ": whole snapshot read");
+
+    compare(name, *engine, *copy);
+    for (size_t i = SPLIT; i < stream.size(); ++i) {
+        engine->update(stream[i]);
+        copy->update(stream[i]);
+    }
+    compare(name + " after more updates", *engine, *copy);
+
+    SnapshotWriter wa, wb;
+    engine->save(wa);
+    copy->save(wb);
+    check(wa.bytes() == wb.bytes(), name + ": state after more updates");
+
+    // A truncated snapshot is rejected rather than read past its end.
+    SnapshotReader cut(w.bytes().data(), w.bytes().size() / 2);
+    check(Engine::load(cut) == nullptr, name + ": truncated");
+}
+
+int main() {
+    const vector<int> stream = ZipfGenerator(0, KEYS, 1.2).generate(STREAM);
+    const double eps = 4.0;
+    const double delta = 1e-6;
+
+    roundTrip("SSSO", make_unique<SSSO>(20, 200, eps, delta), stream);
+    roundTrip("MGSO", make_unique<MGSO>(20, 200, eps, delta), stream);
+    roundTrip("CMSSOHH", make_unique<CMSSOHH>(4, eps, delta, 20, 200, 11, STREAM), stream);
+    roundTrip("SSSOWindow", make_unique<SSSOWindow>(20, 200, eps, delta, 50000, 4), stream);
+    roundTrip("CMSSOHHWindow", make_unique<CMSSOHHWindow>(4, eps, delta, 20, 200, 11, 50000, 4), stream);
+    roundTrip("ContinualCMSSOHH", make_unique<ContinualCMSSOHH>(4, eps, delta, 20, 200, 11, STREAM, 10000), stream);
+    roundTrip("HHHSSSO", make_unique<HHHSSSO>(20, 200, eps, delta), stream);
+    roundTrip("HKSO", make_unique<HKSO>(20, 200, eps, delta, 512, 2, 11), stream);
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    puts("snapshot: all checks passed");
+    return 0;
+}